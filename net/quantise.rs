@@ -4,6 +4,7 @@ use bullet_lib::{
     trainer::save::SavedFormat,
     value::ValueTrainerBuilder,
 };
+use std::fs;
 
 fn main() {
     const CPU_THREADS: usize = 16;
@@ -57,4 +58,30 @@ fn main() {
     let checkpoint = "./checkpoints/petrel128-120/";
     trainer.load_from_checkpoint(checkpoint);
     trainer.save_to_checkpoint(checkpoint);
+
+    // self-describing copies for petrel `setoption name EvalFile value petrel128.nnue`
+    let weights = fs::read(format!("{checkpoint}quantised.bin")).unwrap();
+    let header = evalfile_header(ACC_SIZE as u32, 0, 0, QA as u32, QB as u32, 0);
+    fs::write(format!("{checkpoint}petrel128.nnue"), [header.as_slice(), weights.as_slice()].concat()).unwrap();
+
+    // int8 feature weights (QA/16), half the memory traffic of accumulator updates
+    let l0w_size = 768 * ACC_SIZE * 2;
+    let l0w_i8: Vec<u8> = weights[..l0w_size].chunks_exact(2).map(|w| {
+        let w = i16::from_le_bytes([w[0], w[1]]) as f64 / 16.0;
+        w.round().clamp(-128.0, 127.0) as i8 as u8
+    }).collect();
+    let header = evalfile_header(ACC_SIZE as u32, 0, 0, QA as u32, QB as u32, 1);
+    fs::write(format!("{checkpoint}petrel128-i8.nnue"), [header.as_slice(), l0w_i8.as_slice(), &weights[l0w_size..]].concat()).unwrap();
+}
+
+// 64 bytes header, see readme.txt
+// inputs: 0 = Chess768, 1 = Chess768hm; activation: 0 = SCReLU, 1 = SCReLU with pos/neg heads
+// weights: 0 = i16 feature weights (QA), 1 = i8 feature weights (QA/16)
+fn evalfile_header(acc_neurons: u32, inputs: u32, activation: u32, qa: u32, qb: u32, weights: u32) -> Vec<u8> {
+    let mut header = b"petrelnn".to_vec();
+    for field in [1, acc_neurons, inputs, activation, qa, qb, weights] {
+        header.extend_from_slice(&field.to_le_bytes());
+    }
+    header.resize(64, 0);
+    header
 }
@@ -31,11 +31,13 @@ public:
 
     constexpr Bb pForward() const { return *this >> 8u; }
     constexpr Bb pBackward() const { return *this << 8u; }
-    constexpr Bb pForwardDiag() const { return (*this % Bb{FileH} >> 9u) | (*this % Bb{FileA} >> 7u); }
+    constexpr Bb pForwardDiag() const { return pForwardDiagA() | pForwardDiagH(); }
+    constexpr Bb pForwardDiagA() const { return *this % Bb{FileH} >> 9u; } // towards FileA
+    constexpr Bb pForwardDiagH() const { return *this % Bb{FileA} >> 7u; } // towards FileH
     constexpr Bb pBackwardDiag() const { return (*this % Bb{FileH} << 7u) | (*this % Bb{FileA} << 9u); }
 
     // bidirectional signed rank shift
-    constexpr Bb shiftRank(signed r) { return Bb{ r >= 0 ? (v_ << 8*r) : (v_ >> -8*r) }; }
+    constexpr Bb shiftRank(signed r) const { return Bb{ r >= 0 ? (v_ << 8*r) : (v_ >> -8*r) }; }
 };
 
 constexpr Bb Square::bbRank() const { return Bb{rank()} - Bb{*this}; }
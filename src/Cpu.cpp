@@ -0,0 +1,87 @@
+#include "Cpu.hpp"
+#include "nnue.hpp"
+#include "PositionSide.hpp"
+#include "Pext.hpp"
+
+namespace {
+    Isa selected{Generic};
+    Sliders selectedSliders{HyperbolaSliders};
+}
+
+namespace Cpu {
+    Isa supported() {
+#if CPU_X86
+        __builtin_cpu_init();
+
+        bool sse41 = __builtin_cpu_supports("sse4.1")
+            && __builtin_cpu_supports("ssse3")
+            && __builtin_cpu_supports("popcnt");
+
+        bool avx2 = sse41
+            && __builtin_cpu_supports("avx2")
+            && __builtin_cpu_supports("bmi")
+            && __builtin_cpu_supports("bmi2")
+            && __builtin_cpu_supports("popcnt");
+
+        bool avx512 = avx2
+            && __builtin_cpu_supports("avx512f")
+            && __builtin_cpu_supports("avx512bw")
+            && __builtin_cpu_supports("avx512vl");
+
+        if (avx512) { return Isa{Avx512}; }
+        if (avx2) { return Isa{Avx2}; }
+        if (sse41) { return Isa{Sse41}; }
+#endif
+        return Isa{Generic};
+    }
+
+    Isa isa() {
+        return selected;
+    }
+
+    bool select(Isa isa) {
+        if (supported() < isa) { return false; }
+
+        nnue.selectKernels(isa);
+        smallNnue.selectKernels(isa);
+        selected = isa;
+        PositionSide::selectKernels(isa, sliders());
+        return true;
+    }
+
+    bool select(std::string_view isaName) {
+        for (auto isa : range<Isa>()) {
+            if (isaName == isa.name()) {
+                return select(isa);
+            }
+        }
+        return false;
+    }
+
+    Sliders sliders() {
+        return selected < Isa{Avx2} ? Sliders{HyperbolaSliders} : selectedSliders;
+    }
+
+    bool select(Sliders sliders) {
+        if (sliders.is(PextSliders)) {
+#if CPU_X86
+            if (selected < Isa{Avx2} || !::pextAttacks.init()) { return false; }
+#else
+            return false;
+#endif
+        }
+
+        selectedSliders = sliders;
+        PositionSide::selectKernels(selected, Cpu::sliders());
+        return true;
+    }
+
+    bool selectSliders(std::string_view slidersName) {
+        for (auto sliders : range<Sliders>()) {
+            if (slidersName == sliders.name()) {
+                return select(sliders);
+            }
+        }
+        return false;
+    }
+}
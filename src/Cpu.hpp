@@ -0,0 +1,59 @@
+#ifndef CPU_HPP
+#define CPU_HPP
+
+#include "Index.hpp"
+
+#if defined __x86_64__
+#   define CPU_X86 1
+#   include <immintrin.h>
+#   define TARGET_SSE41 __attribute__((target("sse4.1,ssse3,popcnt")))
+#   define TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2,popcnt")))
+#   define TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl,avx2,bmi,bmi2,popcnt")))
+#else
+#   define CPU_X86 0
+#endif
+
+// instruction set levels of the hot kernels (NNUE, slider attacks)
+// Generic: compiled for the build target (-march), always available
+// Sse41: x86-64-v2 (SSE4.1, POPCNT)
+// Avx2: x86-64-v3 (AVX2, BMI2)
+// Avx512: x86-64-v4 (AVX-512 F/BW/VL)
+enum isa_t { Generic, Sse41, Avx2, Avx512 };
+struct Isa : Index<Isa, 4, isa_t> {
+    using Index::Index;
+
+    static constexpr io::czstring The_names[] = { "generic", "sse41", "avx2", "avx512" };
+
+    constexpr io::czstring name() const { return The_names[v_]; }
+    friend ostream& operator << (ostream& os, Isa isa) { return os << isa.name(); }
+};
+
+// sliding pieces attacks backends
+// Hyperbola: Hyperbola Quintessence, any instruction set
+// Pext: BMI2 PEXT indexed attack tables, Avx2 and Avx512 instruction sets
+enum sliders_t { HyperbolaSliders, PextSliders };
+struct Sliders : Index<Sliders, 2, sliders_t> {
+    using Index::Index;
+
+    static constexpr io::czstring The_names[] = { "hyperbola", "pext" };
+
+    constexpr io::czstring name() const { return The_names[v_]; }
+    friend ostream& operator << (ostream& os, Sliders sliders) { return os << sliders.name(); }
+};
+
+namespace Cpu {
+    Isa supported(); // the best kernels instruction set supported by the host CPU
+    Isa isa(); // currently selected kernels instruction set
+
+    // switch all kernels to the given instruction set, fails if the host CPU does not support it
+    bool select(Isa);
+    bool select(std::string_view isaName);
+
+    Sliders sliders(); // currently used sliding pieces attacks backend
+
+    // switch the sliding pieces attacks backend, PEXT fails below Avx2 instruction set
+    bool select(Sliders);
+    bool selectSliders(std::string_view slidersName);
+}
+
+#endif
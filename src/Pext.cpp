@@ -0,0 +1,53 @@
+#include "Pext.hpp"
+#include "Hyperbola.hpp"
+#include "System.hpp"
+
+#if CPU_X86
+
+PextAttacks pextAttacks;
+
+namespace {
+    // slider line from the square, excluding edge squares (they do not block anything behind)
+    constexpr Bb relevant(Square sq, Direction dir) {
+        Bb ranks = Bb{Rank1} + Bb{Rank8};
+        Bb files = Bb{FileA} + Bb{FileH};
+
+        switch (*dir) {
+            case FileDir: return sq.bbFile() % ranks;
+            case RankDir: return sq.bbRank() % files;
+            default:      return sq.bbDirection(dir) % (ranks | files);
+        }
+    }
+}
+
+bool PextAttacks::init() {
+    if (isReady()) { return true; }
+
+    u32_t size = 0;
+    for (auto sq : range<Square>()) {
+        rook[sq] = { (relevant(sq, Direction{FileDir}) | relevant(sq, Direction{RankDir})).v(), size };
+        size += u32_t{1} << ::popcount(rook[sq].mask);
+    }
+    for (auto sq : range<Square>()) {
+        bishop[sq] = { (relevant(sq, Direction{DiagonalDir}) | relevant(sq, Direction{AntidiagDir})).v(), size };
+        size += u32_t{1} << ::popcount(bishop[sq].mask);
+    }
+
+    auto table = static_cast<u64_t*>(System::allocateHugePages(size * sizeof(u64_t)));
+    if (!table) { return false; }
+
+    for (auto sq : range<Square>()) {
+        for (auto [ty, line] : { std::pair{SliderType{Rook}, rook[sq]}, std::pair{SliderType{Bishop}, bishop[sq]} }) {
+            u64_t count = U64(1) << ::popcount(line.mask);
+            for (u64_t index = 0; index < count; ++index) {
+                Hyperbola blockers{ Bb{static_cast<u64_t>(_pdep_u64(index, line.mask))} };
+                table[line.offset + index] = blockers.attack(ty, sq).v();
+            }
+        }
+    }
+
+    attacks = table;
+    return true;
+}
+
+#endif // CPU_X86
@@ -0,0 +1,46 @@
+#ifndef PEXT_HPP
+#define PEXT_HPP
+
+#include "Cpu.hpp"
+#include "Bb.hpp"
+
+#if CPU_X86
+
+/**
+ * Sliding pieces attacks looked up in tables indexed by BMI2 PEXT of the relevant occupancy
+ * https://www.chessprogramming.org/BMI2#PEXTBitboards
+ * Tables (840k) are generated at startup from Hyperbola Quintessence, only if selected
+ */
+class PextAttacks {
+    struct Line {
+        u64_t mask; // relevant occupancy: lines from the square excluding the board edges
+        u32_t offset; // start of the square attacks in the table
+    };
+
+    array<Line, Square> rook;
+    array<Line, Square> bishop;
+    u64_t* attacks = nullptr; // 2^popcount(mask) attacks for each square, rooks and then bishops
+
+    static TARGET_AVX2 Bb lookup(const u64_t* table, const Line& line, Bb occupied) {
+        return Bb{ table[line.offset + static_cast<u32_t>(_pext_u64(occupied.v(), line.mask))] };
+    }
+
+public:
+    // allocate and fill the tables, false if out of memory
+    TARGET_AVX2 bool init();
+
+    bool isReady() const { return attacks != nullptr; }
+
+    TARGET_AVX2 Bb attack(SliderType ty, Square from, Bb occupied) const {
+        assert (isReady());
+        Bb result{};
+        if (!ty.is(Bishop)) { result |= lookup(attacks, rook[from], occupied); }
+        if (!ty.is(Rook)) { result |= lookup(attacks, bishop[from], occupied); }
+        return result;
+    }
+};
+extern PextAttacks pextAttacks;
+
+#endif // CPU_X86
+
+#endif
@@ -28,6 +28,68 @@ inline u8x16_t cast256_128(u64x4_t i256) {
 #endif
 }
 
+// bit-sliced counters (0..31) for all squares at once: bit i of each square counter is in plane i
+class SquareCount {
+    std::array<u64_t, 5> planes{};
+
+public:
+    constexpr SquareCount() = default;
+
+    // sum of the lanes of three-bit counters (0..4)
+    SquareCount(u64x4_t ones, u64x4_t twos, u64x4_t fours) {
+        // upper lanes plus lower lanes: four-bit counters (0..8) in two lanes
+        std::array<u64x2_t, 4> sum;
+        u64x2_t carry{};
+        for (auto i : range<3>()) {
+            u64x4_t x = i == 0 ? ones : i == 1 ? twos : fours;
+            u64x2_t lo = __builtin_shufflevector(x, x, 0, 1);
+            u64x2_t hi = __builtin_shufflevector(x, x, 2, 3);
+            sum[i] = lo ^ hi ^ carry;
+            carry = (lo & hi) | (carry & (lo ^ hi));
+        }
+        sum[3] = carry;
+
+        // lane 1 plus lane 0
+        u64_t c = 0;
+        for (auto i : range<4>()) {
+            u64_t a = sum[i][0];
+            u64_t b = sum[i][1];
+            planes[i] = a ^ b ^ c;
+            c = (a & b) | (c & (a ^ b));
+        }
+        planes[4] = c;
+    }
+
+    // increment counters of the given squares
+    constexpr void add(Bb bb) {
+        u64_t carry = bb.v();
+        for (auto i : range<5>()) {
+            if (carry == 0) { return; }
+            u64_t sum = planes[i] ^ carry;
+            carry &= planes[i];
+            planes[i] = sum;
+        }
+    }
+
+    // squares where this counter is greater than the other one
+    constexpr Bb greater(const SquareCount& other) const {
+        u64_t gt = 0;
+        u64_t eq = ~U64(0);
+        for (auto i = 5; i-- > 0; ) {
+            gt |= eq & planes[i] & ~other.planes[i];
+            eq &= ~(planes[i] ^ other.planes[i]);
+        }
+        return Bb{gt};
+    }
+
+    // opponent's point of view (bitboards flipped)
+    constexpr SquareCount operator ~ () const {
+        SquareCount result;
+        for (auto i : range<5>()) { result.planes[i] = ::byteswap(planes[i]); }
+        return result;
+    }
+};
+
 class CACHE_ALIGN PiBb {
     union {
         u64x4_t u64x4[4];
@@ -91,6 +153,20 @@ public:
 
     constexpr void clear(Pi pi) { bb_[pi] = {}; }
 
+    // raw bitboards of all pieces for masked stores of vectorized kernels
+    u64_t* data() { return reinterpret_cast<u64_t*>(&u64x4[0]); }
+
+    // number of pieces attacking each square
+    SquareCount count() const {
+        // carry-save adders of four pieces in each 64-bit lane
+        auto [a, b, c, d] = u64x4;
+        auto ab = a ^ b;
+        auto s = ab ^ c;
+        auto twos1 = (a & b) | (ab & c);
+        auto twos2 = s & d;
+        return SquareCount{ s ^ d, twos1 ^ twos2, twos1 & twos2 };
+    }
+
     Bb bb() const {
         auto a64 = u64x4[0] | u64x4[1] | u64x4[2] | u64x4[3];
 
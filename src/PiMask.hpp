@@ -229,6 +229,9 @@ public:
 
     constexpr PiMask any() const { return PiMask{u8x16 != ::u8x16x(Square::null())}; }
 
+    // squares of all pieces at once for vectorized kernels
+    constexpr u8x16_t v() const { return u8x16; }
+
     constexpr PiMask anyOn(Rank::_t rank) const {
         return PiMask{
             (u8x16 & ::u8x16x( static_cast<_t>(Square::null() ^ static_cast<_t>(File::mask())) ))
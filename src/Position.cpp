@@ -1,26 +1,100 @@
 #include "Position_impl.hpp"
 
 Score Position::evaluate() const {
-    auto eval = accumulator.evaluate();
+    assert (isEvalReady_);
+    auto eval = accumulator.evaluate(nnue);
+    return Score::clampEval(eval);
+}
+
+Score Position::evaluateSmall() const {
+    assert (isSmallEvalReady_);
+    auto eval = smallAccumulator.evaluate(smallNnue);
     return Score::clampEval(eval);
 }
 
 void Position::flip(const Position& parent) {
-    // copy from the parent position but swap sides
-    accumulator.flip(parent.accumulator);
+    // copy from the parent position but swap sides, accumulators are updated later if needed
+    isEvalReady_ = false;
+    isSmallEvalReady_ = false;
+    accUpdate = {}; // null move
     positionSide_[My] = parent.OP;
     positionSide_[Op] = parent.MY;
     rule50_ = parent.rule50_;
 }
 
 void Position::makeMove(Square from, Square to) {
+    auto parentAccumulator = accumulator;
+    auto parentSmallAccumulator = smallAccumulator;
     PositionSide::swap(MY, OP);
-    accumulator.swap();
 
     // the position just swapped its sides, so we make the move for the Op
     makeMove<Op, Full>(from, to, []{});
     zobrist_.flip();
     //assert (z() == *generateZobrist()); // true, but slow to compute
+
+    // game history positions are always evaluated
+    accumulator.update(nnue, parentAccumulator, accUpdate, *this);
+    isEvalReady_ = true;
+    if (smallNnue.isLoaded()) {
+        smallAccumulator.update(smallNnue, parentSmallAccumulator, accUpdate, *this);
+        isSmallEvalReady_ = true;
+    }
+}
+
+void Position::makeMove(Undo& undo, Square from, Square to) {
+    // attack matrix rows the move can change: moved and captured pieces and sliders affected by the move squares
+    PiMask myRows = MY.affectedBy(from, to) | PiMask{MY.pi(from)};
+    PiMask opRows = OP.affectedBy(~from, ~to);
+    if (OP.has(~to)) { opRows |= PiMask{OP.pi(~to)}; }
+
+    if (MY.isPawn(from)) {
+        if (from.on(Rank7)) {
+            // promoted piece can take any vacant piece index
+            Square promo{to.file(), Rank8};
+            myRows |= MY.affectedBy(promo) | (PiMask{::u8x16x(0xff)} % MY.any());
+            opRows |= OP.affectedBy(~promo);
+            if (OP.has(~promo)) { opRows |= PiMask{OP.pi(~promo)}; }
+        } else if (from.on(Rank5) && to.on(Rank5)) {
+            // en passant capture encoded as the pawn captures the pawn
+            Square ep{to.file(), Rank6};
+            myRows |= MY.affectedBy(ep);
+            opRows |= OP.affectedBy(~ep);
+        }
+    } else if (MY.isKing(to)) {
+        // castling encoded as the rook captures own king
+        myRows |= PiMask{Pi{TheKing}};
+    }
+
+    MY.save(undo.positionSide[My], myRows);
+    OP.save(undo.positionSide[Op], opRows);
+    undo.occupied = occupied_;
+    undo.zobrist = zobrist_;
+    undo.zHash = zHash_;
+    undo.rule50 = rule50_;
+    undo.accUpdate = accUpdate;
+    undo.isEvalReady = isEvalReady_;
+    undo.isSmallEvalReady = isSmallEvalReady_;
+
+    isEvalReady_ = false;
+    isSmallEvalReady_ = false;
+    PositionSide::swap(MY, OP);
+
+    // the position just swapped its sides, so we make the move for the Op
+    makeMove<Op, NoEval>(from, to, []{});
+    zobrist_.flip();
+}
+
+void Position::unmakeMove(const Undo& undo) {
+    PositionSide::swap(MY, OP);
+    MY.restore(undo.positionSide[My]);
+    OP.restore(undo.positionSide[Op]);
+    occupied_ = undo.occupied;
+    zobrist_ = undo.zobrist;
+    zHash_ = undo.zHash;
+    rule50_ = undo.rule50;
+    accUpdate = undo.accUpdate;
+    isEvalReady_ = undo.isEvalReady;
+    isSmallEvalReady_ = undo.isSmallEvalReady;
 }
 
 void Position::makeNullMove(const Position& parent) {
@@ -69,18 +143,49 @@ bool Position::dropValid(Side si, PieceType ty, Square to) {
 bool Position::afterDrop() {
     PositionSide::finalSetup(MY, OP);
     updateSliderAttacks<Op>(OP.any(), MY.any());
-    accumulator.setup(*this);
+    setupAccumulator();
     rule50_ = {};
 
     // opponent should not be in check
     return MY.checkers().none();
 }
 
+void Position::setupAccumulator() {
+    setupMainAccumulator();
+    if (smallNnue.isLoaded()) {
+        smallAccumulator.setup(smallNnue, *this);
+        isSmallEvalReady_ = true;
+    } else {
+        isSmallEvalReady_ = false;
+    }
+}
+
+void Position::setupMainAccumulator() {
+    accumulator.setup(nnue, *this);
+    isEvalReady_ = true;
+}
+
+void NnueBatch::add(const Position& pos) {
+    assert (!isFull());
+
+    auto addRows = [this](int a) {
+        rowCount_[a] = 0;
+        return [this, a](Nnue::FeatureIndex fi) { rows_[a][rowCount_[a]++] = net.w0(fi); };
+    };
+
+    forEachFeature<My>(pos, net.mirrorMask(pos.positionSide(My).sqKing()), addRows(2*size_));
+    forEachFeature<Op>(pos, net.mirrorMask(pos.positionSide(Op).sqKing()), addRows(2*size_ + 1));
+    ++size_;
+}
+
 Bb Position::bbPassedPawns() const {
     Bb blockers = ~(OP.bbPawns() | OP.bbPawnAttacks().pForward());
-    for (int i = 0; i < 5; ++i) {
-        blockers |= blockers.pBackward();
-    }
+
+    // logarithmic fill: 1, 2 and 4 ranks cover the whole file behind each blocker
+    blockers |= blockers.pBackward();
+    blockers |= blockers.shiftRank(2);
+    blockers |= blockers.shiftRank(4);
+
     return MY.bbPawns() % blockers;
 }
 
@@ -94,6 +199,56 @@ Zobrist Position::generateZobrist() const {
     return z;
 }
 
+Z Position::keyAfter(Square from, Square to) const {
+    Zobrist z{zobrist_};
+
+    if (OP.hasEnPassant()) [[unlikely]] {
+        z.opEnPassant(OP.sqEnPassant());
+
+        if (MY.isPawn(from) && from.on(Rank5) && to.on(Rank5)) {
+            // en passant capture encoded as the pawn captures the pawn
+            z.move(Pawn, from, Square{to.file(), Rank6});
+            z.opCapture(NonKingType{Pawn}, ~to);
+            return *z.flip();
+        }
+    }
+
+    if (MY.isPawn(from)) {
+        if (from.on(Rank7)) {
+            PromoType promoType{::promoTypeFrom(to.rank())};
+            to = {to.file(), Rank8};
+            z.promote(from, promoType, to);
+        } else {
+            z.move(Pawn, from, to);
+            if (from.on(Rank2) && to.on(Rank4) && legalEnPassantKillers<My>(to, OCCUPIED - Bb{from} + Bb{to}).any()) {
+                z.enPassant(to);
+            }
+        }
+    } else if (MY.isKing(from)) {
+        for (Pi rook : MY.castlingRooks()) { z.castling(MY.sq(rook)); }
+        z.move(King, from, to);
+    } else {
+        Pi pi = MY.pi(from);
+
+        if (MY.isCastling(pi)) {
+            if (MY.isKing(to)) {
+                // castling move encoded as castling rook captures own king
+                for (Pi rook : MY.castlingRooks()) { z.castling(MY.sq(rook)); }
+                z.castle(to, CastlingRules::castlingKingTo(to, from), from, CastlingRules::castlingRookTo(to, from));
+                return *z.flip();
+            }
+            z.castling(from);
+        }
+        z.move(MY.typeOf(pi), from, to);
+    }
+
+    if (OP.has(~to)) {
+        if (OP.isCastling(~to)) { z.opCastling(~to); } // captured the rook with castling right
+        z.opCapture(NonKingType{*OP.typeAt(~to)}, ~to);
+    }
+    return *z.flip();
+}
+
 Zobrist Position::generateZobrist() const {
     constexpr Side::_t Op{~My};
 
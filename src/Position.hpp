@@ -90,7 +90,11 @@ public:
 };
 
 class Position {
-    DualAcc accumulator; // NNUE evaluation accumulators (a pair from each side perspective)
+    // cold: read and written only by the lazy evaluation, kept in front of the hot fields of the search node
+    DualAcc<Nnue::Max_neurons> accumulator; // NNUE evaluation accumulators (a pair from each side perspective)
+    DualAcc<Nnue::Small_neurons> smallAccumulator; // small network accumulators, used only if it is loaded
+
+    // hot: copied or written by flip() in every node, contiguous with the PositionMoves and Node fields
     array<PositionSide, Side> positionSide_; // copied from the parent, updated incrementally
     array<Bb, Side> occupied_; // both color pieces combined, updated from positionSide[] after each move
 
@@ -98,7 +102,11 @@ class Position {
     ZHash zHash_; // mini-hash of all previous reversible positions zobrist keys of the same color
     Rule50 rule50_; // number of halfmoves since last capture or pawn move, incremented or reset by makeMove()
 
-    // copy parent position but flip sides
+    AccUpdate accUpdate; // features change of the last move, accumulators are updated from the parent on demand
+    bool isEvalReady_{false}; // accumulator is computed
+    bool isSmallEvalReady_{false}; // smallAccumulator is computed
+
+    // copy parent position but flip sides, accumulators are left for lazy update
     void flip(const Position& parent);
 
     enum MakeMoveFlags {
@@ -123,20 +131,6 @@ protected:
     // all occupied squares by both sides from the given side point of view
     constexpr Bb occupied(Side side) const { return occupied_[side]; }
 
-    // myAttackers > opAttackers
-    bool safeForMe(Square sq) const {
-        int myAttackers = MY.countAttackersTo(sq, OCCUPIED);
-        int opAttackers = OP.countAttackersTo(~sq, OP_OCCUPIED);
-        return myAttackers > opAttackers;
-    }
-
-    // opAttackers > myAttackers
-    bool safeForOp(Square sq) const {
-        int myAttackers = MY.countAttackersTo(sq, OCCUPIED);
-        int opAttackers = OP.countAttackersTo(~sq, OP_OCCUPIED);
-        return opAttackers > myAttackers;
-    }
-
     // update the position without updating the zobrist hash (because it unneeded anymore)
     void makeMovePerft(const Position&, Square, Square);
     void makeMovePerft(const Position&, Square, Square, auto&& prefetch);
@@ -145,15 +139,47 @@ protected:
     bool makeMove(const Position&, Square, Square, ZHash, auto&& prefetch);
     void makeNullMove(const Position&);
 
+    // position state changed by makeMove(Undo&, ...) and restored by unmakeMove()
+    struct Undo {
+        array<PositionSide::Undo, Side> positionSide;
+        array<Bb, Side> occupied;
+        Zobrist zobrist;
+        ZHash zHash;
+        Rule50 rule50;
+        AccUpdate accUpdate;
+        bool isEvalReady;
+        bool isSmallEvalReady;
+    };
+
+    // make/unmake alternative to copy-make: update the position and its zobrist hash inplace,
+    // accumulators are left intact but unusable until unmakeMove()
+    void makeMove(Undo&, Square, Square);
+    void unmakeMove(const Undo&);
+
     template <Side::_t> void setLegalEnPassant(Square);
+
+    // opponent pawns that can legally capture en passant the just double pushed pawn, given the occupied squares after the push
+    template <Side::_t> Bb legalEnPassantKillers(Square, Bb) const;
     void setZobrist() { zobrist_ = generateZobrist(); }
 
     void setRule50(Rule50 rule50) { rule50_ = rule50; }
 
+    // lazy evaluation: accumulators are computed from the parent position accumulators only when needed
+    constexpr bool isEvalReady() const { return isEvalReady_; }
+    constexpr bool isSmallEvalReady() const { return isSmallEvalReady_; }
+    void updateEval(const Position& parent);
+    void updateSmallEval(const Position& parent);
+
+    // small network static evaluation, less accurate but faster
+    Score evaluateSmall() const;
+
 public:
     // position hash
     constexpr auto z() const { return *zobrist_; }
 
+    // hash of the child position after the legal move, calculated without making the move (for early TT prefetch)
+    Z keyAfter(Square from, Square to) const;
+
     // repetition hash
     constexpr auto zHash() const { return zHash_; }
 
@@ -172,6 +198,10 @@ public:
     bool afterDrop();
     bool setEnPassant(File);
 
+    // recalculate evaluation accumulators from scratch (after EvalFile or EvalFileSmall change)
+    void setupAccumulator();
+    void setupMainAccumulator(); // main network only (evalbatch reference timing)
+
 // output FEN:
 
     // number of halfmoves since last capture or pawn move
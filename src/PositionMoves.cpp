@@ -134,9 +134,9 @@ void PositionMoves::generateCheckEvasions() {
     generateLegalKingMoves<My>();
 }
 
-// generate all legal moves from the current position for the current side to move
+// set attacked squares and generate legal moves only if in check
 template <Side::_t My>
-void PositionMoves::generateMoves() {
+void PositionMoves::generateEvasions() {
     constexpr Side::_t Op{~My};
     bbAttacked_ = ~OP.attacks().bb();
 
@@ -145,8 +145,16 @@ void PositionMoves::generateMoves() {
 
     if (inCheck_) {
         generateCheckEvasions<My>();
-        return;
     }
+}
+
+// generate all legal moves from the current position for the current side to move
+template <Side::_t My>
+void PositionMoves::generateMoves() {
+    constexpr Side::_t Op{~My};
+
+    generateEvasions<My>();
+    if (inCheck_) { return; }
 
     // create pseudolegal moves from piece attacks
     // (including invalid phantom pawn captures and missing pawn non-captures)
@@ -170,8 +178,255 @@ void PositionMoves::generateMoves() {
     generateLegalKingMoves<My>();
 }
 
+// generate legal captures and queen promotions directly from the attack matrix, not in check
+template <Side::_t My>
+void PositionMoves::generateCaptures() {
+    constexpr Side::_t Op{~My};
+    assert (!inCheck_);
+
+    // piece attacks of opponent pieces (pawn attacks are exactly pawn captures)
+    moves_.setAttacks(MY.attacks());
+    moves_ &= ~OP.bbSide();
+
+    // non-capture queen promotions
+    for (Pi pi : MY.promotables()) {
+        moves_.set(pi, moves_.bb(pi) + (Bb{MY.sq(pi)}.pForward() % OCCUPIED));
+    }
+
+    excludePinnedMoves<My>(OP.pinners());
+
+    // trust out legal enpassant flag
+    if (MY.hasEnPassant()) { generateEnPassantMoves<My>(); }
+
+    // king moves are few and prove that the position is not stalemate
+    generateLegalKingMoves<My>();
+}
+
+// any piece of the side to move is truly pinned to its king
+template <Side::_t My>
+bool PositionMoves::hasPinned() const {
+    constexpr Side::_t Op{~My};
+
+    for (Pi pinner : OP.pinners()) {
+        Bb occupiedPinLine = ::inBetween(MY.sqKing(), ~OP.sq(pinner)) & OCCUPIED;
+        if (occupiedPinLine.isSingleton() && occupiedPinLine.any(MY.bbSide())) { return true; }
+    }
+    return false;
+}
+
+// count legal moves directly from the attack matrix, without filling the moves matrix
+template <Side::_t My>
+MovesNumber PositionMoves::countMoves() {
+    generateEvasions<My>();
+
+    // special cases left to the full move generation
+    if (inCheck_ || MY.hasEnPassant() || hasPinned<My>()) {
+        generateMoves<My>();
+        return moves().popcount();
+    }
+
+    MovesNumber n = 0;
+    for (Pi pi : MY.officers()) {
+        n += (MY.attacks().bb(pi) % MY.bbSide()).popcount();
+    }
+
+    // pawn moves of all pawns at once, each promotion counted as queen, rook, bishop and knight moves
+    auto countPawnMoves = [](Bb bb) { return bb.popcount() + 3 * (bb & Bb{Rank8}).popcount(); };
+
+    Bb pawns = MY.bbPawns();
+    Bb pushes = pawns.pForward() % OCCUPIED;
+    n += countPawnMoves(pushes);
+    n += ((pushes & Bb{Rank3}).pForward() % OCCUPIED).popcount(); // double pushes
+    n += countPawnMoves(pawns.pForwardDiagA() & ~OP.bbSide()); // captures
+    n += countPawnMoves(pawns.pForwardDiagH() & ~OP.bbSide());
+
+    for (Pi pi : MY.castlingRooks()) {
+        n += ::castlingRules.isLegal(MY.sqKing(), MY.sq(pi), OCCUPIED, bbAttacked());
+    }
+
+    n += (::attacksFrom(King, MY.sqKing()) % (MY.bbSide() | bbAttacked())).popcount();
+    return n;
+}
+
 void PositionMoves::generateMoves() {
     generateMoves<My>();
+    safetyQueries_ = 0;
+    movesTotal_ = moves().popcount();
+    movesMade_ = 0;
+}
+
+void PositionMoves::generateEvasions() {
+    generateEvasions<My>();
+    safetyQueries_ = 0;
+    movesTotal_ = inCheck_ ? moves().popcount() : 0; // unknown until generateMoves()
+    movesMade_ = 0;
+}
+
+MovesNumber PositionMoves::countMoves() {
+    movesTotal_ = countMoves<My>();
+    safetyQueries_ = 0;
+    movesMade_ = 0;
+    return movesTotal_;
+}
+
+void PositionMoves::generateCaptures() {
+    generateEvasions<My>();
+    safetyQueries_ = 0;
+    if (!inCheck_) { generateCaptures<My>(); }
     movesTotal_ = moves().popcount();
+
+    if (movesTotal_ == 0 && !inCheck_) [[unlikely]] {
+        // neither captures nor king moves, tell stalemate apart
+        generateMoves<My>();
+        movesTotal_ = moves().popcount();
+    }
     movesMade_ = 0;
 }
+
+// attackers of all squares counted at once, when the node asks for safety of many squares
+void PositionMoves::setSafety() {
+    SquareCount my = MY.countAttackers(OCCUPIED);
+    SquareCount op = ~OP.countAttackers(OP_OCCUPIED);
+    bbSafeForMe_ = my.greater(op);
+    bbSafeForOp_ = op.greater(my);
+
+#ifndef NDEBUG
+    for (auto sq : range<Square>()) {
+        int myAttackers = MY.countAttackersTo(sq, OCCUPIED);
+        int opAttackers = OP.countAttackersTo(~sq, OP_OCCUPIED);
+        assert (bbSafeForMe_.has(sq) == (myAttackers > opAttackers));
+        assert (bbSafeForOp_.has(sq) == (opAttackers > myAttackers));
+    }
+#endif
+}
+
+namespace {
+    constexpr int value(PieceType::_t ty) { return ::pieceCountTable.centipawns(PieceType{ty}); }
+
+    // pieces attacking the square on the empty board, both squares from the side point of view
+    PiMask exchangers(const PositionSide& side, Square to) {
+        PiMask result = side.attackersTo(to) % side.sliders();
+        for (Pi pi : side.sliders()) {
+            if (::attacksFrom(side.typeOf(pi), side.sq(pi)).has(to)) { result += PiMask{pi}; }
+        }
+        return result;
+    }
+
+    // exchangers with clear line to the square, so sliders behind already exchanged pieces join in (X-ray)
+    PiMask attackers(const PositionSide& side, PiMask exchangers, Square to, Bb occupied) {
+        PiMask result = exchangers % side.sliders();
+        for (Pi pi : exchangers & side.sliders()) {
+            if (::inBetween(to, side.sq(pi)).none(occupied)) { result += PiMask{pi}; }
+        }
+        return result;
+    }
+
+    // pieces pinned to the side king that cannot leave the pin line to capture on the square
+    PiMask pinned(const PositionSide& side, const PositionSide& op, Square to, Bb occupied) {
+        PiMask result{};
+        for (Pi pinner : op.pinners()) {
+            Square pinnerSq = ~op.sq(pinner);
+            Bb pinLine = ::inBetween(side.sqKing(), pinnerSq);
+
+            Bb blockers = pinLine & occupied;
+            if (blockers.popcount() != 1 || !side.bbSide().has(blockers.index())) { continue; }
+
+            if (!(pinLine + Bb{pinnerSq}).has(to)) {
+                result += PiMask{side.pi(blockers.index())};
+            }
+        }
+        return result;
+    }
+}
+
+// swap list algorithm: https://www.chessprogramming.org/SEE_-_The_Swap_Algorithm
+bool PositionMoves::seeGe(Square from, Square to, int margin) const {
+    Pi pi = MY.pi(from);
+    PieceType::_t ty = *MY.typeOf(pi);
+    Bb bbOccupied = OCCUPIED - Bb{from};
+
+    int swap = -margin;
+    if (OP.has(~to)) {
+        swap += value(*OP.typeAt(~to));
+    }
+
+    if (ty == Pawn && from.on(Rank5) && to.on(Rank5)) {
+        // en passant capture encoded as the pawn captures the pawn
+        bbOccupied -= Bb{to};
+        to = Square{to.file(), Rank6};
+    }
+
+    if (MY.isPromotable(pi)) {
+        assert (to.on(Rank8)); // only queen promotion
+        swap += value(Queen) - value(Pawn);
+        ty = Queen;
+    }
+
+    // even if the moved piece is lost for free
+    if (swap < 0) { return false; }
+
+    // even if the moved piece is captured without compensation
+    swap = value(ty) - swap;
+    if (swap <= 0) { return true; }
+
+    array<PiMask, Side> exchange;
+    exchange[My] = exchangers(MY, to) % PiMask{pi};
+    exchange[Op] = exchangers(OP, ~to);
+
+    // pin lines are from before the move, as if the pinners stay in place during the exchange
+    if (OP.pinners().any()) { exchange[My] %= pinned(MY, OP, to, OCCUPIED); }
+    if (MY.pinners().any()) { exchange[Op] %= pinned(OP, MY, ~to, OP_OCCUPIED); }
+
+    int result = 1;
+    for (Side::_t si = Op; ; si = ~si) {
+        const PositionSide& side = positionSide(si);
+        Square sq = si == My ? to : ~to;
+        Bb bb = si == My ? bbOccupied : ~bbOccupied;
+
+        PiMask ready = attackers(side, exchange[si], sq, bb);
+        if (ready.none()) { break; }
+        result ^= 1;
+
+        // least valuable attacker
+        PiMask lva = ready & side.pawns();
+        if (lva.none()) { lva = ready & side.lessOrEqualValue(PieceType{Bishop}); }
+        if (lva.none()) { lva = ready & side.lessOrEqualValue(PieceType{Rook}); }
+        if (lva.none()) { lva = ready & side.lessOrEqualValue(PieceType{Queen}); }
+
+        if (lva.none()) {
+            // king captures only if the opponent has no attackers left
+            Side::_t other = ~si;
+            bool defended = attackers(positionSide(other), exchange[other], ~sq, ~bb).any();
+            return defended ? result ^ 1 : result;
+        }
+
+        Pi attacker = lva.piLast();
+        swap = value(*side.typeOf(attacker)) - swap;
+        if (swap < result) { break; }
+
+        exchange[si] -= PiMask{attacker};
+        bbOccupied -= si == My ? Bb{side.sq(attacker)} : Bb{~side.sq(attacker)};
+    }
+
+    return result;
+}
+
+bool PositionMoves::isCheck(Square from, Square to) const {
+    PieceType ty = MY.typeAt(from);
+    Bb bbOccupied = OCCUPIED - Bb{from};
+
+    if (ty.is(Pawn) && from.on(Rank5) && to.on(Rank5)) {
+        // en passant capture encoded as the pawn captures the pawn
+        bbOccupied -= Bb{to};
+        to = Square{to.file(), Rank6};
+    }
+    bbOccupied |= Bb{to}; // can be the captured piece square
+
+    // discovered check
+    if (MY.isPinned(bbOccupied)) { return true; }
+
+    // direct check, king cannot give it
+    Square opKing{~OP.sqKing()};
+    if (!::attacksFrom(ty, to).has(opKing)) { return false; }
+    return ty.is(Pawn) || ty.is(Knight) || ::inBetween(to, opKing).none(bbOccupied);
+}
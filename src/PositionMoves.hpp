@@ -13,6 +13,19 @@ class PositionMoves : public Position {
     MovesNumber movesMade_; // number of moves already made in this node (set to 0 during moves generation)
     bool inCheck_; // king of current side to move is under attack (set during moves generation)
 
+    int safetyQueries_; // number of safeForMe() and safeForOp() calls in this node (reset during moves generation)
+    Bb bbSafeForMe_; // squares where my attackers outnumber op attackers (valid after setSafety())
+    Bb bbSafeForOp_; // squares where op attackers outnumber my attackers (valid after setSafety())
+    void setSafety();
+
+    // the first few squares are counted one by one, the next query counts all squares at once
+    static constexpr int SafetyMapQueries = 2;
+    bool isSafetyMapped() {
+        if (safetyQueries_ < SafetyMapQueries) { ++safetyQueries_; return false; }
+        if (safetyQueries_ == SafetyMapQueries) { ++safetyQueries_; setSafety(); }
+        return true;
+    }
+
     // legal move generation helpers
     template <Side::_t> void excludePinnedMoves(PiMask);
     template <Side::_t> void correctCheckEvasionsByPawns(Bb, Square);
@@ -22,15 +35,43 @@ class PositionMoves : public Position {
     template <Side::_t> void generateCastlingMoves();
     template <Side::_t> void generateLegalKingMoves();
     template <Side::_t> void generateCheckEvasions();
+    template <Side::_t> void generateEvasions();
     template <Side::_t> void generateMoves();
+    template <Side::_t> void generateCaptures();
+    template <Side::_t> bool hasPinned() const;
+    template <Side::_t> MovesNumber countMoves();
 
 protected:
     void setMoves(const decltype(moves_)& moves) { moves_ = moves; movesMade_ = 0; }
     void clearMove(Square from, Square to) { moves_.clear(MY.pi(from), to); ++movesMade_; }
 
+    // myAttackers > opAttackers (including X-ray)
+    bool safeForMe(Square sq) {
+        if (isSafetyMapped()) { return bbSafeForMe_.has(sq); }
+        return MY.countAttackersTo(sq, OCCUPIED) > OP.countAttackersTo(~sq, OP_OCCUPIED);
+    }
+
+    // opAttackers > myAttackers (including X-ray)
+    bool safeForOp(Square sq) {
+        if (isSafetyMapped()) { return bbSafeForOp_.has(sq); }
+        return OP.countAttackersTo(~sq, OP_OCCUPIED) > MY.countAttackersTo(sq, OCCUPIED);
+    }
+
 public:
     void generateMoves();
 
+    // cheap part of generateMoves(): attacked squares, in check flag and legal moves only if in check,
+    // so checkmate is detected early and generateMoves() of other positions can be deferred
+    void generateEvasions();
+
+    // quiescence search subset of legal moves: captures, queen promotions and all legal king moves
+    // (all legal moves if in check or if the subset is empty, so movesTotal() == 0 is still stalemate)
+    void generateCaptures();
+
+    // perft leaf counter: movesTotal() without filling the moves matrix
+    // (the moves matrix is valid only if in check, with a pinned piece or en passant)
+    MovesNumber countMoves();
+
     // not yet made set of legal moves
     constexpr const auto& moves() const { return moves_; }
 
@@ -67,6 +108,12 @@ public:
 
     // pieces that have a not yet made legal move to the target square
     PiMask canMoveTo(Square sq) const { return moves_.piMask(sq); }
+
+    // static exchange evaluation of the legal move is at least the margin (centipawns)
+    bool seeGe(Square from, Square to, int margin = 0) const;
+
+    // the legal move (not promotion or castling) gives direct or discovered check
+    bool isCheck(Square from, Square to) const;
 };
 
 #endif
@@ -1,5 +1,6 @@
 #include "PositionSide.hpp"
 #include "Hyperbola.hpp"
+#include "Pext.hpp"
 
 #ifndef NDEBUG
 #endif
@@ -17,6 +18,39 @@ void PositionSide::swap(PositionSide& MY, PositionSide& OP) {
     swap(MY.opKing, OP.opKing);
 }
 
+void PositionSide::save(Undo& undo, PiMask rows) const {
+    undo.rows = rows;
+    int i = 0;
+    for (Pi pi : rows) {
+        undo.attacks[i++] = attacks_.bb(pi);
+    }
+
+    undo.types = types;
+    undo.traits = traits;
+    undo.squares = squares;
+    undo.bbSide_ = bbSide_;
+    undo.bbPawns_ = bbPawns_;
+    undo.bbPawnAttacks_ = bbPawnAttacks_;
+    undo.material_ = material_;
+    undo.opKing = opKing;
+}
+
+void PositionSide::restore(const Undo& undo) {
+    int i = 0;
+    for (Pi pi : undo.rows) {
+        attacks_.set(pi, undo.attacks[i++]);
+    }
+
+    types = undo.types;
+    traits = undo.traits;
+    squares = undo.squares;
+    bbSide_ = undo.bbSide_;
+    bbPawns_ = undo.bbPawns_;
+    bbPawnAttacks_ = undo.bbPawnAttacks_;
+    material_ = undo.material_;
+    opKing = undo.opKing;
+}
+
 void PositionSide::finalSetup(PositionSide& MY, PositionSide& OP) {
     MY.setOpKing(~OP.sqKing());
     OP.setOpKing(~MY.sqKing());
@@ -68,6 +102,37 @@ int PositionSide::countAttackersTo(Square sq0, Bb occupied) const {
     return count;
 }
 
+SquareCount PositionSide::countAttackers(Bb occupied) const {
+    SquareCount count = attacks_.count();
+
+    // X-ray attackers: sliders behind the own sliders of the same line type (battery)
+    Bb bbRooks{};
+    for (Pi pi : types.anyOf(Rook) | types.anyOf(Queen)) { bbRooks += Bb{sq(pi)}; }
+
+    Bb bbBishops{};
+    for (Pi pi : types.anyOf(Bishop) | types.anyOf(Queen)) { bbBishops += Bb{sq(pi)}; }
+
+    // battery pieces are transparent, the rest blocks X-ray attacks
+    // opponent king is transparent for the checkers attacks
+    Hyperbola rookBlockers{(occupied - Bb{opKing}) % bbRooks};
+    Hyperbola bishopBlockers{(occupied - Bb{opKing}) % bbBishops};
+
+    for (Pi pi : sliders()) {
+        Bb attack = attacks_.bb(pi);
+        Bb xray{};
+
+        if (!typeOf(pi).is(Bishop) && attack.any(bbRooks)) {
+            xray |= rookBlockers.attack(SliderType{Rook}, sq(pi));
+        }
+        if (!typeOf(pi).is(Rook) && attack.any(bbBishops)) {
+            xray |= bishopBlockers.attack(SliderType{Bishop}, sq(pi));
+        }
+        count.add(xray % attack);
+    }
+
+    return count;
+}
+
 void PositionSide::setLeaperAttacks() {
     assert (traits.checkers().none());
 
@@ -233,7 +298,11 @@ void PositionSide::setOpKing(Square king) {
     }
 }
 
-void PositionSide::updateSliders(PiMask affectedSliders, Bb occupiedBb) {
+// primary templates are the portable kernels, compiled for the build target instruction set
+// other instruction set kernels are the same code inlined into the target specific functions below
+
+template <Isa::_t>
+[[gnu::always_inline]] inline void PositionSide::updateSliders(PiMask affectedSliders, Bb occupiedBb) {
     assert (traits.checkers().none());
     assert (affectedSliders.any());
 
@@ -247,7 +316,8 @@ void PositionSide::updateSliders(PiMask affectedSliders, Bb occupiedBb) {
     }
 }
 
-void PositionSide::updateSlidersCheckers(PiMask affectedSliders, Bb occupiedBb) {
+template <Isa::_t>
+[[gnu::always_inline]] inline void PositionSide::updateSlidersCheckers(PiMask affectedSliders, Bb occupiedBb) {
     assert (types.sliders().none(traits.checkers()));
     assert (affectedSliders.any());
 
@@ -264,6 +334,221 @@ void PositionSide::updateSlidersCheckers(PiMask affectedSliders, Bb occupiedBb)
     }
 }
 
+#if CPU_X86
+
+template <>
+TARGET_SSE41 void PositionSide::updateSliders<Sse41>(PiMask affectedSliders, Bb occupiedBb) {
+    updateSliders<Generic>(affectedSliders, occupiedBb);
+}
+
+template <>
+TARGET_SSE41 void PositionSide::updateSlidersCheckers<Sse41>(PiMask affectedSliders, Bb occupiedBb) {
+    updateSlidersCheckers<Generic>(affectedSliders, occupiedBb);
+}
+
+template <>
+TARGET_AVX2 void PositionSide::updateSliders<Avx2>(PiMask affectedSliders, Bb occupiedBb) {
+    updateSliders<Generic>(affectedSliders, occupiedBb);
+}
+
+template <>
+TARGET_AVX2 void PositionSide::updateSlidersCheckers<Avx2>(PiMask affectedSliders, Bb occupiedBb) {
+    updateSlidersCheckers<Generic>(affectedSliders, occupiedBb);
+}
+
+namespace {
+    /**
+     * Hyperbola Quintessence of eight sliders at once, one slider per 64-bit lane
+     * reversed lines are generated directly from the reversed squares, so only the result is bitreversed
+     */
+    class Hyperbola8 {
+        __m512i occupied; // occupied bitboard in each lane
+        __m512i reversed; // bitreversed occupied bitboard in each lane
+
+        // bitreverse 64-bit lanes: reverse bytes, then bits inside each byte
+        static TARGET_AVX512 __m512i bitReverse(__m512i v) {
+            const __m512i byteSwap = _mm512_broadcast_i32x4(_mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7));
+            v = _mm512_shuffle_epi8(v, byteSwap);
+#ifdef __GFNI__
+            return _mm512_gf2p8affine_epi64_epi8(v, _mm512_set1_epi64(static_cast<i64_t>(U64(0x8040201008040201))), 0);
+#else
+            const __m512i nibbleSwap = _mm512_broadcast_i32x4(_mm_set_epi8(15, 7, 11, 3, 13, 5, 9, 1, 14, 6, 10, 2, 12, 4, 8, 0));
+            const __m512i nibble = _mm512_set1_epi8(0x0f);
+            auto lo = _mm512_shuffle_epi8(nibbleSwap, _mm512_and_si512(v, nibble));
+            auto hi = _mm512_shuffle_epi8(nibbleSwap, _mm512_and_si512(_mm512_srli_epi16(v, 4), nibble));
+            return _mm512_or_si512(_mm512_slli_epi16(lo, 4), hi);
+#endif
+        }
+
+        // sum of sliding attacks along file, rank, diagonal and antidiagonal lines of the given squares
+        static TARGET_AVX512 __m512i attacks(__m512i occupied, __m512i sq, __mmask8 rooks, __mmask8 bishops) {
+            const __m512i one = _mm512_set1_epi64(1);
+            auto bb = _mm512_sllv_epi64(one, sq);
+            auto rank8 = _mm512_andnot_si512(_mm512_set1_epi64(7), sq); // rank * 8
+            auto file8 = _mm512_slli_epi64(_mm512_and_si512(sq, _mm512_set1_epi64(7)), 3); // file * 8
+
+            //TRICK: shift counts out of 0..63 range (including negative) give zero
+            auto diagonal = _mm512_set1_epi64(static_cast<i64_t>(U64(0x8040201008040201)));
+            auto antidiag = _mm512_set1_epi64(static_cast<i64_t>(U64(0x0102040810204080)));
+            auto diagonalShift = _mm512_sub_epi64(rank8, file8);
+            auto antidiagShift = _mm512_sub_epi64(_mm512_add_epi64(rank8, file8), _mm512_set1_epi64(56));
+
+            __m512i lines[] = {
+                _mm512_maskz_sllv_epi64(rooks, _mm512_set1_epi64(static_cast<i64_t>(U64(0x0101010101010101))), _mm512_srli_epi64(file8, 3)),
+                _mm512_maskz_sllv_epi64(rooks, _mm512_set1_epi64(0xff), rank8),
+                _mm512_maskz_or_epi64(bishops,
+                    _mm512_sllv_epi64(diagonal, diagonalShift),
+                    _mm512_srlv_epi64(diagonal, _mm512_sub_epi64(_mm512_setzero_si512(), diagonalShift))),
+                _mm512_maskz_or_epi64(bishops,
+                    _mm512_sllv_epi64(antidiag, antidiagShift),
+                    _mm512_srlv_epi64(antidiag, _mm512_sub_epi64(_mm512_setzero_si512(), antidiagShift))),
+            };
+
+            auto result = _mm512_setzero_si512();
+            for (auto line : lines) {
+                line = _mm512_andnot_si512(bb, line);
+                auto blockers = _mm512_and_si512(occupied, line);
+                result = _mm512_or_si512(result, _mm512_and_si512(_mm512_sub_epi64(blockers, bb), line));
+            }
+            return result;
+        }
+
+    public:
+        // fixed cost of the vector path pays off only for several sliders, fewer are updated one by one
+        static constexpr int MinSliders = 4;
+
+        TARGET_AVX512 explicit Hyperbola8(Bb bb) :
+            occupied{ _mm512_set1_epi64(static_cast<i64_t>(bb.v())) },
+            reversed{ bitReverse(occupied) }
+        {}
+
+        // attacks of the eight sliders on the given squares (reverse(sq) == 63 - sq)
+        TARGET_AVX512 __m512i attack(__m512i sq, __mmask8 rooks, __mmask8 bishops) const {
+            auto forward = attacks(occupied, sq, rooks, bishops);
+            auto backward = attacks(reversed, _mm512_sub_epi64(_mm512_set1_epi64(63), sq), rooks, bishops);
+            return _mm512_xor_si512(forward, bitReverse(backward));
+        }
+    };
+}
+
+template <>
+TARGET_AVX512 void PositionSide::updateSliders<Avx512>(PiMask affectedSliders, Bb occupiedBb) {
+    assert (traits.checkers().none());
+    assert (affectedSliders.any());
+
+    if (affectedSliders.popcount() < Hyperbola8::MinSliders) {
+        updateSliders<Generic>(affectedSliders, occupiedBb);
+        return;
+    }
+
+    Hyperbola8 blockers{ occupiedBb };
+
+    auto squares16 = static_cast<__m128i>(squares.v());
+    unsigned affected = PieceSet{affectedSliders}.v();
+    unsigned rooks = PieceSet{types.anyOf(Rook) | types.anyOf(Queen)}.v();
+    unsigned bishops = PieceSet{types.anyOf(Bishop) | types.anyOf(Queen)}.v();
+
+    for (int half : range<2>()) {
+        __mmask8 k = static_cast<__mmask8>(affected >> (8*half));
+        if (k == 0) { continue; }
+
+        auto sq = _mm512_cvtepu8_epi64(half == 0 ? squares16 : _mm_unpackhi_epi64(squares16, squares16));
+        auto attack = blockers.attack(sq, static_cast<__mmask8>(rooks >> (8*half)), static_cast<__mmask8>(bishops >> (8*half)));
+        _mm512_mask_storeu_epi64(attacks_.data() + 8*half, k, attack);
+
+        assert (_mm512_mask_test_epi64_mask(k, attack, _mm512_set1_epi64(static_cast<i64_t>(Bb{opKing}.v()))) == 0); // king cannot be left in check
+    }
+}
+
+template <>
+TARGET_AVX512 void PositionSide::updateSlidersCheckers<Avx512>(PiMask affectedSliders, Bb occupiedBb) {
+    assert (types.sliders().none(traits.checkers()));
+    assert (affectedSliders.any());
+
+    if (affectedSliders.popcount() < Hyperbola8::MinSliders) {
+        updateSlidersCheckers<Generic>(affectedSliders, occupiedBb);
+        return;
+    }
+
+    //TRICK: attacks calculated without opponent's king for implicit out of check king moves generation
+    Hyperbola8 blockers{ occupiedBb - Bb{opKing} };
+
+    auto squares16 = static_cast<__m128i>(squares.v());
+    unsigned affected = PieceSet{affectedSliders}.v();
+    unsigned rooks = PieceSet{types.anyOf(Rook) | types.anyOf(Queen)}.v();
+    unsigned bishops = PieceSet{types.anyOf(Bishop) | types.anyOf(Queen)}.v();
+
+    for (int half : range<2>()) {
+        __mmask8 k = static_cast<__mmask8>(affected >> (8*half));
+        if (k == 0) { continue; }
+
+        auto sq = _mm512_cvtepu8_epi64(half == 0 ? squares16 : _mm_unpackhi_epi64(squares16, squares16));
+        auto attack = blockers.attack(sq, static_cast<__mmask8>(rooks >> (8*half)), static_cast<__mmask8>(bishops >> (8*half)));
+        _mm512_mask_storeu_epi64(attacks_.data() + 8*half, k, attack);
+
+        __mmask8 checkers = _mm512_mask_test_epi64_mask(k, attack, _mm512_set1_epi64(static_cast<i64_t>(Bb{opKing}.v())));
+        for (unsigned c = checkers; c != 0; c &= c - 1) {
+            traits.setChecker(Pi{static_cast<Pi::_t>(8*half + std::countr_zero(c))});
+        }
+    }
+}
+
+// BMI2 PEXT attack tables backend, for Avx2 and Avx512 instruction sets
+
+TARGET_AVX2 void PositionSide::updateSlidersPext(PiMask affectedSliders, Bb occupiedBb) {
+    assert (traits.checkers().none());
+    assert (affectedSliders.any());
+
+    for (Pi pi : affectedSliders) {
+        Bb attack = ::pextAttacks.attack(SliderType{*typeOf(pi)}, sq(pi), occupiedBb);
+        attacks_.set(pi, attack);
+
+        assert (!attack.has(opKing)); // king cannot be left in check
+    }
+}
+
+TARGET_AVX2 void PositionSide::updateSlidersCheckersPext(PiMask affectedSliders, Bb occupiedBb) {
+    assert (types.sliders().none(traits.checkers()));
+    assert (affectedSliders.any());
+
+    //TRICK: attacks calculated without opponent's king for implicit out of check king moves generation
+    occupiedBb -= Bb{opKing};
+
+    for (Pi pi : affectedSliders) {
+        Bb attack = ::pextAttacks.attack(SliderType{*typeOf(pi)}, sq(pi), occupiedBb);
+        attacks_.set(pi, attack);
+
+        if (attack.has(opKing)) {
+            traits.setChecker(pi);
+        }
+    }
+}
+
+#endif // CPU_X86
+
+constinit PositionSide::Kernels PositionSide::kernels {
+    &PositionSide::updateSliders<Generic>, &PositionSide::updateSlidersCheckers<Generic>
+};
+
+void PositionSide::selectKernels(Isa isa, [[maybe_unused]] Sliders sliders) {
+    constexpr array<Kernels, Isa> The_kernels {
+        Kernels{ &PositionSide::updateSliders<Generic>, &PositionSide::updateSlidersCheckers<Generic> },
+        Kernels{ &PositionSide::updateSliders<Sse41>, &PositionSide::updateSlidersCheckers<Sse41> },
+        Kernels{ &PositionSide::updateSliders<Avx2>, &PositionSide::updateSlidersCheckers<Avx2> },
+        Kernels{ &PositionSide::updateSliders<Avx512>, &PositionSide::updateSlidersCheckers<Avx512> },
+    };
+    kernels = The_kernels[isa];
+
+#if CPU_X86
+    if (sliders.is(PextSliders)) {
+        assert (Isa{Avx2} <= isa && ::pextAttacks.isReady());
+        kernels = Kernels{ &PositionSide::updateSlidersPext, &PositionSide::updateSlidersCheckersPext };
+    }
+#else
+    assert (sliders.is(HyperbolaSliders));
+#endif
+}
+
 void PositionSide::setEnPassantVictim(Square ep) {
     assert (isPawn(ep));
     assert (ep.on(Rank4));
@@ -1,6 +1,7 @@
 #ifndef POSITION_SIDE_HPP
 #define POSITION_SIDE_HPP
 
+#include "Cpu.hpp"
 #include "PiBb.hpp"
 #include "PiMask.hpp"
 #include "Score.hpp"
@@ -55,6 +56,20 @@ class PositionSide {
     void setLeaperAttack(Pi, PieceType, Square);
     void setPinner(Pi, SliderType, Square);
 
+    // slider attacks updates, compiled for each instruction set and selected at startup
+    template <Isa::_t> void updateSliders(PiMask, Bb);
+    template <Isa::_t> void updateSlidersCheckers(PiMask, Bb);
+#if CPU_X86
+    void updateSlidersPext(PiMask, Bb);
+    void updateSlidersCheckersPext(PiMask, Bb);
+#endif
+
+    struct Kernels {
+        void (PositionSide::*updateSliders)(PiMask, Bb);
+        void (PositionSide::*updateSlidersCheckers)(PiMask, Bb);
+    };
+    static Kernels kernels;
+
 public:
     // incremental piece count and material score for the given side to move
     constexpr Material material() const { return material_; }
@@ -111,6 +126,7 @@ public:
     PiMask affectedBy(Square a, Square b) const { return affectedBy(a) | affectedBy(b); }
     PiMask affectedBy(Square a, Square b, Square c) const { return affectedBy(a) | affectedBy(b) | affectedBy(c); }
     int countAttackersTo(Square, Bb) const; // total number of attackers (including X-ray)
+    SquareCount countAttackers(Bb) const; // countAttackersTo() of all squares at once
 
     PiMask checkers() const { assert (traits.checkers() == attackersTo(opKing)); return traits.checkers(); }
     constexpr PiMask pinners() const { return traits.pinners(); }
@@ -148,6 +164,24 @@ public:
 //friend class Position;
     static void swap(PositionSide&, PositionSide&);
 
+    // side state before a move: only the attack matrix rows the move can change and all other fields
+    class Undo {
+        friend class PositionSide;
+        PiMask rows; // pieces which attacks are saved
+        std::array<Bb, Pi::size()> attacks; // the first rows.popcount() entries in piece index order
+        PiType types;
+        PiTrait traits;
+        PiSquare squares;
+        Bb bbSide_;
+        Bb bbPawns_;
+        Bb bbPawnAttacks_;
+        Material material_;
+        Square opKing;
+    };
+
+    void save(Undo&, PiMask rows) const;
+    void restore(const Undo&);
+
     void setOpKing(Square);
     void move(Pi, Square, Square);
     void move(Pi, PieceType, Square, Square);
@@ -163,8 +197,9 @@ public:
     void clearEnPassantKillers();
     void clearCheckers() { traits.clearCheckers(); }
 
-    void updateSliders(PiMask, Bb);
-    void updateSlidersCheckers(PiMask, Bb);
+    void updateSliders(PiMask affected, Bb occupied) { (this->*kernels.updateSliders)(affected, occupied); }
+    void updateSlidersCheckers(PiMask affected, Bb occupied) { (this->*kernels.updateSlidersCheckers)(affected, occupied); }
+    static void selectKernels(Isa, Sliders);
 
     // used only during initial position setup
     bool dropValid(PieceType, Square);
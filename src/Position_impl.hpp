@@ -28,56 +28,69 @@ void Position::updateSliderAttacks(PiMask myAffected, PiMask opAffected) {
 }
 
 template <Side::_t My>
-void Position::setLegalEnPassant(Square ep) {
+Bb Position::legalEnPassantKillers(Square ep, Bb occupied) const {
     constexpr Side::_t Op{~My};
 
-    assert (ep.on(Rank4));
-    assert (MY.isPawn(ep));
-    assert (!MY.hasEnPassant());
-    assert (!OP.hasEnPassant());
-
     Square to{ep.file(), Rank3}; // attacking pawn destination square
 
     // check if there are any pawns to capture ep victim
     Bb killers{~OP.bbPawns() & ::attacksFrom(Pawn, to)};
-    if (killers.none()) { return; }
+    if (killers.none()) { return {}; }
 
     // discovered check
-    if (MY.isPinned(OCCUPIED)) { assert ((MY.checkers() % PiMask{MY.pi(ep)}).any()); return; }
-    assert ((MY.checkers() % PiMask{MY.pi(ep)}).none());
+    if (MY.isPinned(occupied)) { return {}; }
 
+    Bb legalKillers{};
     for (Square from : killers) {
         assert (from.on(Rank4));
 
-        if (!MY.isPinned(OCCUPIED - Bb{from} + Bb{to} - Bb{ep})) {
-            MY.setEnPassantVictim(ep);
-            OP.setEnPassantKiller(~from);
+        if (!MY.isPinned(occupied - Bb{from} + Bb{to} - Bb{ep})) {
+            legalKillers += Bb{from};
         }
     }
+    return legalKillers;
+}
+
+template <Side::_t My>
+void Position::setLegalEnPassant(Square ep) {
+    constexpr Side::_t Op{~My};
+
+    assert (ep.on(Rank4));
+    assert (MY.isPawn(ep));
+    assert (!MY.hasEnPassant());
+    assert (!OP.hasEnPassant());
+
+    // discovered check
+    assert (!MY.isPinned(OCCUPIED) || (MY.checkers() % PiMask{MY.pi(ep)}).any());
+    assert (MY.isPinned(OCCUPIED) || (MY.checkers() % PiMask{MY.pi(ep)}).none());
+
+    for (Square from : legalEnPassantKillers<My>(ep, OCCUPIED)) {
+        MY.setEnPassantVictim(ep);
+        OP.setEnPassantKiller(~from);
+    }
 }
 
-inline void DualAcc::setup(const Position& pos) {
-    mirror[My] = pos.positionSide(My).sqKing().mirrorMask();
-    side[My].setup<My>(pos, mirror[My]);
+template <int Neurons>
+void DualAcc<Neurons>::setup(const Nnue& net, const Position& pos) {
+    mirror[My] = net.mirrorMask(pos.positionSide(My).sqKing());
+    side[My].template setup<My>(net, pos, mirror[My]);
 
-    mirror[Op] = pos.positionSide(Op).sqKing().mirrorMask();
-    side[Op].setup<Op>(pos, mirror[Op]);
+    mirror[Op] = net.mirrorMask(pos.positionSide(Op).sqKing());
+    side[Op].template setup<Op>(net, pos, mirror[Op]);
 }
 
 struct TwinPiIndex : Index<TwinPiIndex, 2*Pi::size()> { using Index::Index; };
 
+// visit all active features of the accumulator from AccMy side perspective
 template <Side::_t AccMy>
-inline void Acc::setup(const Position& pos, Square mirror) {
-    assert (pos.positionSide(AccMy).sqKing().mirrorMask() == mirror);
-
-    int count{0};
-    array<Fi, TwinPiIndex> fi;
+void forEachFeature(const Position& pos, Square mirror, auto&& visit) {
+    using Fi = Nnue::FeatureIndex;
 
     auto& my{ pos.positionSide(AccMy) };
     for (auto pi : my.any()) {
         PieceType ty{ my.typeOf(pi) };
         Square sq{ my.sq(pi) };
-        fi[TwinPiIndex{count++}] = {My, ty, sq, mirror};
+        visit(Fi{My, ty, sq, mirror});
     }
 
     //TRICK: flip pieces squares perspective for opposite side
@@ -86,57 +99,98 @@ inline void Acc::setup(const Position& pos, Square mirror) {
     for (auto pi : op.any()) {
         PieceType ty{ op.typeOf(pi) };
         Square sq{ op.sq(pi) };
-        fi[TwinPiIndex{count++}] = {Op, ty, sq, mirror};
+        visit(Fi{Op, ty, sq, mirror});
     }
+}
 
-    for (auto i : range<AccIndex>()) {
-        _t a{};
-        for (int tpi = 0; tpi < count; ++tpi) {
-            #if USE_AVX2
-                a = _mm256_adds_epi16(a, nnue.w0[fi[TwinPiIndex{tpi}]][i]);
-            #else
-                a += nnue.w0[fi[TwinPiIndex{tpi}]][i];
-            #endif
-        }
-        acc[i] = a;
-    }
+template <int Neurons>
+template <Side::_t AccMy>
+void Acc<Neurons>::setup(const Nnue& net, const Position& pos, Square mirror) {
+    assert (net.mirrorMask(pos.positionSide(AccMy).sqKing()) == mirror);
+
+    int count{0};
+    array<Nnue::WRow, TwinPiIndex> rows;
+    forEachFeature<AccMy>(pos, mirror, [&](Fi fi) { rows[TwinPiIndex{count++}] = net.w0(fi); });
+
+    net.kernels().setup(acc.data(), rows.data(), count);
 }
 
-constexpr void DualAcc::moveKing(const Position& pos, Square from, Square to) {
-    assert (from != to);
-    if (+(from ^ to) & 4) {
-        // king crossed the horizontal middle line
-        mirror[Op] = mirror[Op].mirror();
-        side[Op].setup<Op>(pos, mirror[Op]);
-    } else {
-        side[Op].move(mirror[Op], My, King, from, to);
+// pos is the position after the move, its sides are flipped relative to the parent
+template <int Neurons>
+void DualAcc<Neurons>::update(const Nnue& net, const DualAcc& parent, const AccUpdate& u, const Position& pos) {
+    mirror[My] = parent.mirror[Op];
+    mirror[Op] = parent.mirror[My];
+
+    auto& parentOp = parent.side[My]; // the side just made the move
+    auto& parentMy = parent.side[Op];
+
+    switch (u.kind) {
+        case AccUpdate::NullMove:
+            side[Op].copy(net, parentOp);
+            side[My].copy(net, parentMy);
+            break;
+
+        case AccUpdate::PieceMove:
+            side[Op].move(net, parentOp, mirror[Op], My, u.ty, u.from, u.to);
+            side[My].move(net, parentMy, ~mirror[My], Op, u.ty, u.from, u.to);
+            break;
+
+        case AccUpdate::PieceCapture:
+            side[Op].move(net, parentOp, mirror[Op], My, u.ty, u.from, u.to, u.captured);
+            side[My].move(net, parentMy, ~mirror[My], Op, u.ty, u.from, u.to, u.captured);
+            break;
+
+        case AccUpdate::Promotion:
+            side[Op].promote(net, parentOp, mirror[Op], My, u.from, u.ty, u.to);
+            side[My].promote(net, parentMy, ~mirror[My], Op, u.from, u.ty, u.to);
+            break;
+
+        case AccUpdate::PromotionCapture:
+            side[Op].promote(net, parentOp, mirror[Op], My, u.from, u.ty, u.to, u.captured);
+            side[My].promote(net, parentMy, ~mirror[My], Op, u.from, u.ty, u.to, u.captured);
+            break;
+
+        case AccUpdate::EnPassant:
+            side[Op].ep(net, parentOp, mirror[Op], My, u.from, u.to, u.from2);
+            side[My].ep(net, parentMy, ~mirror[My], Op, u.from, u.to, u.from2);
+            break;
+
+        case AccUpdate::KingMove:
+        case AccUpdate::KingCapture:
+        case AccUpdate::Castling:
+            if (net.isMirrorChanged(u.from, u.to)) {
+                // king crossed the horizontal middle line
+                mirror[Op] = mirror[Op].mirror();
+                side[Op].template setup<Op>(net, pos, mirror[Op]);
+            } else if (u.kind == AccUpdate::KingMove) {
+                side[Op].move(net, parentOp, mirror[Op], My, King, u.from, u.to);
+            } else if (u.kind == AccUpdate::KingCapture) {
+                side[Op].move(net, parentOp, mirror[Op], My, King, u.from, u.to, u.captured);
+            } else {
+                side[Op].castle(net, parentOp, mirror[Op], My, u.from, u.to, u.from2, u.to2);
+            }
+
+            if (u.kind == AccUpdate::KingMove) {
+                side[My].move(net, parentMy, ~mirror[My], Op, King, u.from, u.to);
+            } else if (u.kind == AccUpdate::KingCapture) {
+                side[My].move(net, parentMy, ~mirror[My], Op, King, u.from, u.to, u.captured);
+            } else {
+                side[My].castle(net, parentMy, ~mirror[My], Op, u.from, u.to, u.from2, u.to2);
+            }
+            break;
     }
-    side[My].move(~mirror[My], Op, King, from, to);
 }
 
-constexpr void DualAcc::moveKing(const Position& pos, Square from, Square to, NonKingType captured) {
-    assert (from != to);
-    if (+(from ^ to) & 4) {
-        // king crossed the horizontal middle line
-        mirror[Op] = mirror[Op].mirror();
-        side[Op].setup<Op>(pos, mirror[Op]);
-    } else {
-        side[Op].move(mirror[Op], My, King, from, to, captured);
-    }
-    side[My].move(~mirror[My], Op, King, from, to, captured);
+inline void Position::updateEval(const Position& parent) {
+    assert (parent.isEvalReady_);
+    accumulator.update(nnue, parent.accumulator, accUpdate, *this);
+    isEvalReady_ = true;
 }
 
-constexpr void DualAcc::castle(const Position& pos, Square kingFrom, Square kingTo, Square rookFrom, Square rookTo) {
-    assert (kingFrom != rookFrom); assert (kingTo != rookTo);
-    assert (kingFrom.on(Rank1)); assert (rookTo.on(Rank1));
-    if (+(kingFrom ^ kingTo) & 4) {
-        // king crossed the horizontal middle line
-        mirror[Op] = mirror[Op].mirror();
-        side[Op].setup<Op>(pos, mirror[Op]);
-    } else {
-        side[Op].castle(mirror[Op], My, kingFrom, kingTo, rookFrom, rookTo);
-    }
-    side[My].castle(~mirror[My], Op, kingFrom, kingTo, rookFrom, rookTo);
+inline void Position::updateSmallEval(const Position& parent) {
+    assert (parent.isSmallEvalReady_);
+    smallAccumulator.update(smallNnue, parent.smallAccumulator, accUpdate, *this);
+    isSmallEvalReady_ = true;
 }
 
 template <Side::_t My, Position::MakeMoveFlags Flags>
@@ -165,7 +219,7 @@ bool Position::makeMove(Square from, Square to, auto&& flipPrefetch) {
             MY.clearEnPassantKillers(); // can be two
             MY.movePawn(from, to);
             updateSliderAttacks<My>(MY.affectedBy(from, to, ep), OP.affectedBy(~from, ~to, ~ep));
-            if constexpr (Flags & WithEval) { accumulator.ep(from, to, ep); }
+            if constexpr (Flags & WithEval) { accUpdate.ep(from, to, ep); }
             return true; // end of en passant capture move
         }
 
@@ -196,7 +250,7 @@ bool Position::makeMove(Square from, Square to, auto&& flipPrefetch) {
                 OP.capture(~to);
                 MY.movePawn(from, to);
                 updateSliderAttacks<My>(MY.affectedBy(from), OP.affectedBy(~from));
-                if constexpr (Flags & WithEval) { accumulator.move(Pawn, from, to, captured); }
+                if constexpr (Flags & WithEval) { accUpdate.move(Pawn, from, to, captured); }
                 return true; // end of simple pawn capture move
             } else {
                 if (from.on(Rank2) && to.on(Rank4)) {
@@ -214,7 +268,7 @@ bool Position::makeMove(Square from, Square to, auto&& flipPrefetch) {
                     MY.movePawn(from, to);
                     updateSliderAttacks<My>(MY.affectedBy(from, to), OP.affectedBy(~from, ~to));
                 }
-                if constexpr (Flags & WithEval) { accumulator.move(Pawn, from, to); }
+                if constexpr (Flags & WithEval) { accUpdate.move(Pawn, from, to); }
                 return true; // end of simple pawn push move
             }
         } else [[unlikely]] {
@@ -235,14 +289,14 @@ bool Position::makeMove(Square from, Square to, auto&& flipPrefetch) {
                 OP.capture(~to);
                 Pi promoted{MY.piPromoted(from, promoType, to)}; // promoted piece index can differ from pawn piece index
                 updateSliderAttacks<My>(MY.affectedBy(from) | PiMask{promoted}, OP.affectedBy(~from));
-                if constexpr (Flags & WithEval) { accumulator.promote(from, promoType, to, captured); }
+                if constexpr (Flags & WithEval) { accUpdate.promote(from, promoType, to, captured); }
                 return true; // end of pawn promotion move with capture
             } else {
                 if constexpr (Flags & WithZobrist) { flipPrefetch(); }
 
                 Pi promoted{MY.piPromoted(from, promoType, to)}; // promoted piece index can differ from pawn piece index
                 updateSliderAttacks<My>(MY.affectedBy(from, to) | PiMask{promoted}, OP.affectedBy(~from, ~to));
-                if constexpr (Flags & WithEval) { accumulator.promote(from, promoType, to); }
+                if constexpr (Flags & WithEval) { accUpdate.promote(from, promoType, to); }
                 return true; // end of pawn promotion move without capture
             }
         } // promotion or not
@@ -273,7 +327,7 @@ bool Position::makeMove(Square from, Square to, auto&& flipPrefetch) {
             MY.move(Pi{TheKing}, from, to);
             MY.updateMovedKing(to);
             updateSliderAttacks<My>(MY.affectedBy(from)); // king cannot affect enemy attacks
-            if constexpr (Flags & WithEval) { accumulator.moveKing(*this, from, to, captured); }
+            if constexpr (Flags & WithEval) { accUpdate.moveKing(from, to, captured); }
             return true; // end of king capture move
         } else {
             if constexpr (Flags & WithZobrist) {
@@ -285,7 +339,7 @@ bool Position::makeMove(Square from, Square to, auto&& flipPrefetch) {
             MY.updateMovedKing(to);
             OP.setOpKing(~to);
             updateSliderAttacks<My>(MY.affectedBy(from, to)); // king cannot affect enemy attacks
-            if constexpr (Flags & WithEval) { accumulator.moveKing(*this, from, to); }
+            if constexpr (Flags & WithEval) { accUpdate.moveKing(from, to); }
             return shouldResetZHash; // end of king non-capture move
         }
     } // no king moves anymore
@@ -316,7 +370,7 @@ bool Position::makeMove(Square from, Square to, auto&& flipPrefetch) {
             //TRICK: castling rook should attack 'kingFrom' square
             //TRICK: only first rank sliders can be affected
             updateSliderAttacks<My>(MY.affectedBy(rookFrom, kingFrom) & MY.anyOn(Rank1));
-            if constexpr (Flags & WithEval) { accumulator.castle(*this, kingFrom, kingTo, rookFrom, rookTo); }
+            if constexpr (Flags & WithEval) { accUpdate.castle(kingFrom, kingTo, rookFrom, rookTo); }
             return true; // end of castling move
         }
 
@@ -342,7 +396,7 @@ bool Position::makeMove(Square from, Square to, auto&& flipPrefetch) {
         OP.capture(~to);
         MY.move(pi, promoType, from, to);
         updateSliderAttacks<My>(MY.affectedBy(from) | PiMask{pi}, OP.affectedBy(~from));
-        if constexpr (Flags & WithEval) { accumulator.move(promoType, from, to, captured); }
+        if constexpr (Flags & WithEval) { accUpdate.move(promoType, from, to, captured); }
         return true; // end of officer's capture
     } else {
         if constexpr (Flags & WithZobrist) {
@@ -352,7 +406,7 @@ bool Position::makeMove(Square from, Square to, auto&& flipPrefetch) {
 
         MY.move(pi, promoType, from, to);
         updateSliderAttacks<My>(MY.affectedBy(from, to), OP.affectedBy(~from, ~to));
-        if constexpr (Flags & WithEval) { accumulator.move(promoType, from, to); }
+        if constexpr (Flags & WithEval) { accUpdate.move(promoType, from, to); }
         return shouldResetZHash; // end of officers's noncapture move
     }
 }
@@ -372,8 +426,8 @@ bool Position::makeMove(const Position& parent, Square from, Square to, ZHash zH
     // current position flipped its sides relative to parent, so we make the move inplace for the Op
     bool shouldResetZHash = makeMove<Op, Full>(from, to, flipPrefetch);
     //assert (z() == generateZobrist().v()); // true, but slow to compute
+    assert (z() == parent.keyAfter(from, to));
 
-    prefetch(z()); // prefetch again after NNUE update
     return shouldResetZHash;
 }
 
@@ -261,6 +261,9 @@ public:
     }
 
     constexpr _t operator[] (PieceType ty) const { return v_[ty]; }
+
+    // material evaluation of the piece type, the king is never captured
+    constexpr int centipawns(PieceType ty) const { return v_[ty].s.centipawns; }
 };
 extern const PieceCountTable pieceCountTable;
 
@@ -3,6 +3,9 @@
 #ifdef _WIN32
     #include <windows.h>
 #else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
     #include <unistd.h>
 #endif
 
@@ -54,6 +57,17 @@ namespace System {
 #endif
     }
 
+    void* allocateHugePages(size_t size) {
+        constexpr size_t HugePageSize = 2 * 1024 * 1024;
+        size = (size + HugePageSize - 1) & ~(HugePageSize - 1);
+
+        void* result = allocateAligned(size, HugePageSize);
+#if defined MADV_HUGEPAGE
+        if (result) { ::madvise(result, size, MADV_HUGEPAGE); }
+#endif
+        return result;
+    }
+
     int getPid() {
 #ifdef _WIN32
         DWORD pid = GetCurrentProcessId();
@@ -64,4 +78,56 @@ namespace System {
         return pid;
     }
 
+#ifdef _WIN32
+    const void* mapFile(const std::string& fileName, size_t& size) {
+        HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) { return nullptr; }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return nullptr;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping) { return nullptr; }
+
+        // the view keeps the mapping object alive
+        const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!data) { return nullptr; }
+
+        size = static_cast<size_t>(fileSize.QuadPart);
+        return data;
+    }
+
+    void unmapFile(const void* data, size_t) {
+        UnmapViewOfFile(data);
+    }
+#else
+    const void* mapFile(const std::string& fileName, size_t& size) {
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd == -1) { return nullptr; }
+
+        struct stat st;
+        if (::fstat(fd, &st) == -1 || st.st_size <= 0) {
+            ::close(fd);
+            return nullptr;
+        }
+
+        // the mapping stays valid after closing the file descriptor
+        void* data = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) { return nullptr; }
+
+        size = static_cast<size_t>(st.st_size);
+        return data;
+    }
+
+    void unmapFile(const void* data, size_t size) {
+        ::munmap(const_cast<void*>(data), size);
+    }
+#endif
+
 } // end of namespace sys
@@ -1,13 +1,21 @@
 #ifndef MEMORY_HPP
 #define MEMORY_HPP
 
+#include <string>
 #include "bitops.hpp"
 
 namespace System {
     size_t getAvailableMemory();
     void* allocateAligned(size_t size, size_t alignment);
     void  freeAligned(void*);
+
+    // 2MB aligned memory advised for transparent huge pages, freed by freeAligned()
+    void* allocateHugePages(size_t size);
     int getPid();
+
+    // read only memory mapping of the whole file, shared between processes via OS page cache
+    const void* mapFile(const std::string& fileName, size_t& size);
+    void unmapFile(const void*, size_t size);
 }
 
 #endif
@@ -229,4 +229,40 @@ public:
     }
 };
 
+struct TtRecord {
+    TtEntry ttEntry;
+    TtEntry* tt;
+    bool ttHit;
+};
+
+// find the entry of the position or the entry to replace in the pair of entries
+constexpr TtRecord probe(TtEntry* tt, Z z) {
+    auto ttEntry = TtEntry::read(tt);
+    if (ttEntry == z) { return {ttEntry, tt, true}; }
+
+    auto tt2 = std::bit_cast<TtEntry*>(std::bit_cast<std::uintptr_t>(tt) ^ sizeof(TtEntry));
+    auto ttEntry2 = TtEntry::read(tt2);
+    if (ttEntry2 == z) { return {ttEntry2, tt2, true}; }
+
+    //TRICK: zeroed entry is never fresh
+    bool f1 = The_transpositionTable.isFresh(ttEntry.age());
+    bool f2 = The_transpositionTable.isFresh(ttEntry2.age());
+
+    // preserve fresh
+    if (f1 != f2) {
+        if (f2) {
+            return {ttEntry, tt, false};
+        } else {
+            return {ttEntry2, tt2, false};
+        }
+    }
+
+    // preserve deeper or other
+    if (ttEntry.draft() <= ttEntry2.draft()) {
+        return {ttEntry, tt, false};
+    } else {
+        return {ttEntry2, tt2, false};
+    }
+}
+
 #endif
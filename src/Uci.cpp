@@ -1,3 +1,4 @@
+#include <memory>
 #include <set>
 #include "perft.hpp"
 #include "search.hpp"
@@ -767,7 +768,7 @@ Uci::Uci(ostream& os) :
     logStartTime{::timeNow()},
     pid_{System::getPid()}
 {
-    Nnue::validate_embedded_size();
+    nnue.setEmbedded();
     for (auto ply : range<Ply>()) { std::construct_at(&searchStack[ply], ply); }
     inputLine.clear();
     bestmove_.clear();
@@ -777,6 +778,7 @@ Uci::Uci(ostream& os) :
 void Uci::newGame() {
     The_transpositionTable.newGame();
     contMoves = {};
+    historyMoves = {};
     checkMoves = {};
     go_.isNewGame = true;
 }
@@ -855,6 +857,10 @@ void Uci::fen(ostream& os, const Position& pos, Ply ply) const {
 
 ostream& Uci::info_pv(ostream& os) const {
     os << pv.score();
+    if (pv.score().any()) {
+        if (pv.bound().is(FailHigh)) { os << " lowerbound"; }
+        else if (pv.bound().is(FailLow)) { os << " upperbound"; }
+    }
 
     auto* pvMoves = pv.moves();
     if (pvMoves->none()) { return os; } // empty PV (no legal moves at root)
@@ -932,8 +938,10 @@ void Uci::processInput(istream& is) {
         else if (consume("ucinewgame")){ ucinewgame(); }
         else if (consume("uci"))       { uciok(); }
         else if (consume("debug"))     { setDebugOn(); }
+        else if (consume("perftsuite")){ perftsuite(); }
         else if (consume("perft"))     { perft(); }
         else if (consume("bench"))     { bench(); }
+        else if (consume("evalbatch")) { evalbatch(); }
         else if (consume("wait"))      { wait(); }
         else if (consume("quit"))      { break; }
         else if (consume("exit"))      { break; }
@@ -958,6 +966,8 @@ void Uci::uciok() const {
     ob << "\noption name UCI_Chess960 type check default " << (chessVariant().is(Chess960) ? "true" : "false");
     ob << "\noption name Debug type check default " << (debugOn_ ? "true" : "false");
     ob << "\noption name Debug Log File type string default " << (logFileName.empty() ? "<empty>" : logFileName);
+    ob << "\noption name EvalFile type string default " << (evalFileName.empty() ? "<empty>" : evalFileName);
+    ob << "\noption name EvalFileSmall type string default " << (evalFileSmallName.empty() ? "<empty>" : evalFileSmallName);
     ob << "\nuciok";
 }
 
@@ -1004,10 +1014,7 @@ void Uci::setoption() {
     if (consume("Debug Log File")) {
         consume("value");
 
-        inputLine >> std::ws;
-        std::string newFileName;
-        std::getline(inputLine, newFileName);
-        ::rtrim(newFileName);
+        std::string newFileName{readFileName()};
 
         if (newFileName.empty() || newFileName == "<empty>") {
             if (logFile.is_open()) {
@@ -1037,6 +1044,18 @@ void Uci::setoption() {
         return;
     }
 
+    if (consume("EvalFile")) {
+        consume("value");
+        setEvalFile(nnue, Nnue::Max_neurons, evalFileName, &Nnue::setEmbedded);
+        return;
+    }
+
+    if (consume("EvalFileSmall")) {
+        consume("value");
+        setEvalFile(smallNnue, Nnue::Small_neurons, evalFileSmallName, &Nnue::clear);
+        return;
+    }
+
     //TRICK: "Debug Log File" should be the first
     if (consume("Debug")) {
         consume("value");
@@ -1049,6 +1068,46 @@ void Uci::setoption() {
     }
 }
 
+std::string Uci::readFileName() {
+    inputLine >> std::ws;
+    std::string fileName;
+    std::getline(inputLine, fileName);
+    ::rtrim(fileName);
+    return fileName;
+}
+
+bool Uci::openFile(std::ifstream& file, std::string_view fileKind) {
+    std::string fileName{readFileName()};
+
+    file.open(fileName);
+    if (!file) {
+        error("failed opening " + std::string{fileKind} + " file: ", fileName);
+        return false;
+    }
+    return true;
+}
+
+void Uci::setEvalFile(Nnue& net, int maxNeurons, std::string& evalFile, void (Nnue::*setEmpty)()) {
+    std::string newFileName{readFileName()};
+
+    if (newFileName == "<empty>") { newFileName.clear(); }
+    if (newFileName == evalFile) { return; }
+
+    wait();
+
+    if (newFileName.empty()) {
+        (net.*setEmpty)();
+    } else if (auto failure = net.load(newFileName, maxNeurons)) {
+        error(failure, newFileName);
+        return;
+    }
+    evalFile = std::move(newFileName);
+
+    // cached evaluations and root position accumulators belong to the previous network
+    newGame();
+    position_.setupAccumulator();
+}
+
 void Uci::setDebugOn() {
     if (!leftUnparsedInput()) {
         Output ob;
@@ -1214,8 +1273,13 @@ void Uci::go() {
             info_bestmove();
             return;
         } else if (limits.setLimits(go_, position_)) {
-            auto started = mainSearchThread.start([this] {
-                searchStack[0_ply].searchRoot(position_);
+            auto started = mainSearchThread.start([this, mate = go_.mate] {
+                if (mate == 0) {
+                    searchStack[0_ply].searchRoot(position_);
+                } else if (searchStack[0_ply].searchMate(position_, mate) == ReturnStatus::Continue) {
+                    Output ob;
+                    ob << "info string no mate in " << mate;
+                }
                 info_bestmove();
             });
             if (!started) { break; }
@@ -1252,6 +1316,7 @@ void UciLimits::readGo(istream& is) {
     nodes = NodeCountMax;
     movestogo = 0;
     depth = MaxPly;
+    mate = 0;
     ponder = false;
     infinite = false;
 
@@ -1264,6 +1329,7 @@ void UciLimits::readGo(istream& is) {
         else if (io::consume(is, "nodes"))    { is >> nodes; }
         else if (io::consume(is, "movestogo")){ is >> movestogo; if (movestogo < 0) { movestogo = 0; } }
         else if (io::consume(is, "depth"))    { int d; is >> d;  if (Ply::isOk(d)) { depth = Ply{d}; } }
+        else if (io::consume(is, "mate"))     { int n; is >> n;  if (0 < n && Ply::isOk(2*n)) { mate = n; } }
         else if (io::consume(is, "ponder"))   { ponder = true; }
         else if (io::consume(is, "infinite")) { infinite = true; }
         else { break; }
@@ -1389,6 +1455,177 @@ void Uci::perft() {
     } );
 }
 
+// perftsuite [depth <max>] <file.epd>
+// EPD lines: <fen> ;D1 <perft> ;D2 <perft> ... (depths above max are skipped)
+void Uci::perftsuite() {
+    Ply maxDepth{18}; // current Tt implementation limit
+    if (consume("depth")) {
+        inputLine >> maxDepth;
+        maxDepth = std::min<Ply>(maxDepth, 18_ply);
+    }
+
+    std::ifstream file;
+    if (!openFile(file, "perftsuite")) { return; }
+
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line); ) {
+        ::rtrim(line);
+        if (line.empty() || line[0] == '#') { continue; }
+        lines.push_back(std::move(line));
+    }
+
+    newSearch();
+
+    mainSearchThread.start([this, maxDepth, lines = std::move(lines)] {
+        int positions{0};
+        int mismatches{0};
+        auto suiteStart = ::timeNow();
+
+        for (const auto& line : lines) {
+            auto fenEnd = line.find(';');
+
+            std::string fen{line.substr(0, fenEnd)};
+            ::rtrim(fen);
+
+            std::istringstream is{fen};
+            UciPosition pos;
+            pos.readFen(is);
+            if (!is) {
+                error("failed parsing perftsuite fen: ", line);
+                continue;
+            }
+            ++positions;
+
+            auto positionNodes = limits.getNodes();
+            auto positionStart = ::timeNow();
+            Ply lastDepth{0};
+            node_count_t lastPerft{0};
+
+            // expected perft fields are separated by ';'
+            for (auto field = fenEnd; field != std::string::npos; field = line.find(';', field + 1)) {
+                std::istringstream expected{line.substr(field + 1, line.find(';', field + 1) - field - 1)};
+
+                char tag{};
+                int depth{0};
+                node_count_t expectedPerft{0};
+                expected >> tag >> depth >> expectedPerft;
+                if (!expected || tag != 'D' || depth < 1 || depth > +maxDepth) { continue; }
+
+                lastDepth = Ply{static_cast<Ply::_t>(depth)};
+                lastPerft = NodePerft{pos, lastDepth}.countRoot();
+                if (lastPerft == NodeCountNone) {
+                    Output ob;
+                    ob << "info string perftsuite stopped at position " << positions;
+                    return;
+                }
+
+                if (lastPerft != expectedPerft) {
+                    ++mismatches;
+
+                    Output ob;
+                    ob << "info string perftsuite mismatch " << positions << " depth " << depth
+                        << " perft " << lastPerft << " expected " << expectedPerft << " fen " << fen;
+                }
+            }
+
+            auto nodes = limits.getNodes() - positionNodes;
+            auto time = ::elapsedSince(positionStart);
+
+            Output ob;
+            ob << "info string perftsuite " << positions << " depth " << lastDepth << " perft " << lastPerft;
+            ob << " nodes " << nodes << " time " << time;
+            if (time >= 1ms) { ob << " nps " << ::nps(nodes, time); }
+        }
+
+        auto nodes = limits.getNodes();
+        auto time = ::elapsedSince(suiteStart);
+
+        Output ob;
+        ob << "info string perftsuite " << positions << " positions, " << mismatches << " mismatches, "
+            << Mega{nodes} << " nodes " << time << " ms";
+        if (time >= 1ms) { ob << ' ' << Mega{::nps(nodes, time)} << " nps"; }
+    });
+}
+
+void Uci::evalbatch() {
+    std::ifstream file;
+    if (!openFile(file, "evalbatch")) { return; }
+
+    wait();
+
+    constexpr std::size_t Chunk_size = 1024; // positions, evaluated alone first, then in batches
+
+    auto batch = std::make_unique<NnueBatch>(nnue);
+    std::vector<Position> positions;
+    std::vector<std::string> fens;
+    std::vector<Score> singleScores;
+    std::vector<int32_t> results;
+
+    node_count_t count{0};
+    TimeInterval singleTime{0};
+    TimeInterval batchTime{0};
+
+    auto evaluateChunk = [&]() {
+        auto start = ::timeNow();
+        singleScores.clear();
+        for (auto& pos : positions) {
+            // same work as the batch: main network only, even if EvalFileSmall is loaded
+            pos.setupMainAccumulator();
+            singleScores.push_back(pos.evaluate());
+        }
+        singleTime += ::elapsedSince(start);
+
+        start = ::timeNow();
+        results.resize(positions.size());
+        for (std::size_t first = 0; first < positions.size(); first += NnueBatch::Max_size) {
+            batch->clear();
+            for (std::size_t i = first; i < positions.size() && !batch->isFull(); ++i) {
+                batch->add(positions[i]);
+            }
+            batch->evaluate(&results[first]);
+        }
+        batchTime += ::elapsedSince(start);
+
+        for (std::size_t i = 0; i < positions.size(); ++i) {
+            Score score = Score::clampEval(results[i]);
+            if (score != singleScores[i]) {
+                error("evalbatch result differs from single position evaluation: ", fens[i]);
+            }
+
+            Output ob{false};
+            ob << "info" << score << " fen " << fens[i];
+        }
+
+        count += positions.size();
+        positions.clear();
+        fens.clear();
+    };
+
+    UciPosition pos;
+    for (std::string line; std::getline(file, line); ) {
+        ::rtrim(line);
+        if (line.empty()) { continue; }
+
+        std::istringstream is{line};
+        pos.readFen(is);
+        if (!is) {
+            error("failed parsing evalbatch fen: ", line);
+            continue;
+        }
+
+        positions.push_back(pos);
+        fens.push_back(std::move(line));
+        if (positions.size() == Chunk_size) { evaluateChunk(); }
+    }
+    if (!positions.empty()) { evaluateChunk(); }
+
+    Output ob;
+    ob << "info string evalbatch " << Mega{count} << " positions";
+    if (singleTime >= 1ms && batchTime >= 1ms) {
+        ob << ", single " << Mega{::nps(count, singleTime)} << " pps, batch " << Mega{::nps(count, batchTime)} << " pps";
+    }
+}
+
 void Uci::info_perft_bestmove() const {
     Output ob;
     if (hasNewNodes()) { ob << "info"; info_nps(ob) << '\n'; }
@@ -42,6 +42,7 @@ struct UciLimits {
     node_count_t nodes{NodeCountMax}; // go nodes
     int movestogo{0}; // go movestogo
     Ply depth{MaxPly}; // go depth
+    int mate{0}; // go mate (number of moves, 0 if not a mate search)
 
     bool ponder{false}; // go ponder
     bool infinite{false}; // go infinite
@@ -89,6 +90,8 @@ class Uci {
 
     ChessVariant chessVariant_{Orthodox}; // castling moves and fen output format, engine accepts any castling input
     std::string logFileName; // no log by default
+    std::string evalFileName; // embedded NNUE by default
+    std::string evalFileSmallName; // no small NNUE by default
 
 public: // used by search:
     SearchLimits limits; // inited from UciLimits and UciPosition
@@ -97,6 +100,7 @@ public: // used by search:
 //TODO: per search thread
     array<Node, Ply> searchStack;
     ContMoves<4> contMoves;
+    HistoryMoves historyMoves;
     CheckMoves checkMoves;
     PrincipalVariation pv;
     std::array<Move, 6> rootBestMoves;
@@ -110,6 +114,12 @@ private:
     // discovered parsing or other error
     bool leftUnparsedInput() { return !(inputLine >> std::ws).eof(); }
 
+    // the rest of the inputLine is the file name (can contain spaces)
+    std::string readFileName();
+
+    // open the file named by the rest of the inputLine, report the error if failed
+    bool openFile(std::ifstream&, std::string_view fileKind);
+
 // UCI commands handlers:
 
     void uciok() const;
@@ -122,6 +132,8 @@ private:
     void wait();
     void bench();
     void perft();
+    void perftsuite();
+    void evalbatch();
 
     void newGame();
     void newSearch();
@@ -129,6 +141,7 @@ private:
     void setPositionMoves();
     void setHash();
     void setDebugOn();
+    void setEvalFile(Nnue&, int maxNeurons, std::string& evalFile, void (Nnue::*setEmpty)()); // EvalFile or EvalFileSmall
 
     void swapBestMove(std::string&);
     void outputBestMove();
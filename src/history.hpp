@@ -95,6 +95,9 @@ enum continuation_move_t { Counter, DeepCounter, Followup, DeepFollowup };
 struct ContIndex : Index<ContIndex, 4, continuation_move_t> { using Index::Index; };
 
 // Continuation Move table, counter and followup moves together (for cache locality)
+// slot of the previous move is keyed by its move type and destination square only (not origin square),
+// so the whole table is small enough to stay in L2 cache (32 KB for ContMoves<4>),
+// all ContIndex variants of the same slot share a half of a cache line
 template<int _Size>
 class CACHE_ALIGN ContMoves {
 public:
@@ -102,19 +105,80 @@ public:
     struct Index : ::Index<Index, Size> { using ::Index<Index, Size>::Index; };
 
 private:
-    using _t = array<Move, Color, MoveType, Square, Square, ContIndex, Index>;
+    using _t = array<Move, Color, MoveType, Square, ContIndex, Index>;
     _t v_;
 
+    constexpr auto& slot(Color color, Move move) { return v_[color][move.moveType()][move.to()]; }
+    constexpr const auto& slot(Color color, Move move) const { return v_[color][move.moveType()][move.to()]; }
+
 public:
     constexpr Move get(ContIndex::_t ci, Index i, Color color, Move move) const {
         assert (move.any());
-        return v_[color][move.moveType()][move.from()][move.to()][ContIndex{ci}][i];
+        return slot(color, move)[ContIndex{ci}][i];
     }
 
     template <size_t Pos = 0>
     constexpr void set(ContIndex::_t ci, Color color, Move move, Move bestMove) {
         assert (move.any()); assert (bestMove.any());
-        ::insert_unique_compact<Pos>(v_[color][move.moveType()][move.from()][move.to()][ContIndex{ci}], bestMove);
+        ::insert_unique_compact<Pos>(slot(color, move)[ContIndex{ci}], bestMove);
+    }
+};
+
+// quiet moves history counters: butterfly (color, from, to) and continuation (previous move, move) tables
+class CACHE_ALIGN HistoryMoves {
+public:
+    static constexpr int Max = 8192; // each counter saturates at +-Max
+
+    // continuation key: the previous move and the type of its moved piece
+    struct PieceMove {
+        Move move; // none() if there is no previous move or it was a null move
+        PieceType ty{Pawn}; // unused if move.none()
+    };
+
+private:
+    using _t = i16_t;
+    using Butterfly = array<_t, Color, Square, Square>;
+
+    //TRICK: squares are side relative, so both colors share the same continuation table
+    // only officers (Q, R, B, N) moves are ordered by history, 192KB per table
+    using Continuation = array<_t, PieceType, Square, PromoType, Square>; // (previous piece type and destination, officer type and destination)
+
+    Butterfly butterfly_;
+    Continuation counter_; // ply-1 previous move
+    Continuation followup_; // ply-2 previous move
+
+    // gravity: the closer the counter to its limit, the smaller the change
+    static constexpr void update(_t& v, int bonus) {
+        assert (-Max <= bonus && bonus <= Max);
+        v = static_cast<_t>(v + bonus - v * std::abs(bonus) / Max);
+    }
+
+    static constexpr bool isOfficer(PieceType ty) { return PromoType::isOk(+ty); }
+
+    template <class T>
+    static constexpr auto& at(T& t, PieceMove prev, PieceType ty, Move move) {
+        return t[prev.ty][prev.move.to()][PromoType{*ty}][move.to()];
+    }
+
+public:
+    // sum of all three tables, in range [-3*Max, 3*Max]
+    constexpr int get(Color color, Move move, PieceType ty, PieceMove counter, PieceMove followup) const {
+        assert (move.any());
+        int result = butterfly_[color][move.from()][move.to()];
+        if (!isOfficer(ty)) { return result; }
+
+        if (counter.move.any()) { result += at(counter_, counter, ty, move); }
+        if (followup.move.any()) { result += at(followup_, followup, ty, move); }
+        return result;
+    }
+
+    constexpr void update(Color color, Move move, PieceType ty, PieceMove counter, PieceMove followup, int bonus) {
+        assert (move.any());
+        update(butterfly_[color][move.from()][move.to()], bonus);
+        if (!isOfficer(ty)) { return; }
+
+        if (counter.move.any()) { update(at(counter_, counter, ty, move), bonus); }
+        if (followup.move.any()) { update(at(followup_, followup, ty, move), bonus); }
     }
 };
 
@@ -145,6 +209,7 @@ private:
 
     Ply depth_{0}; // latest PV iteration depth
     Score score_{}; // latest PV score
+    Bound bound_{ExactBound}; // FailHigh or FailLow if the latest score is outside the aspiration window
 
 public:
     constexpr PrincipalVariation () {
@@ -152,6 +217,7 @@ public:
         pv_[Index{1}] = {};
         depth_ = 0_ply;
         score_ = {};
+        bound_ = ExactBound;
     }
 
     // clear child PV space: pv_[i] = {}
@@ -178,9 +244,10 @@ public:
 
     /// set root PV depth, score and PV moves
     /// @return Index of space past PV
-    Index set(Ply depth, Score score, Move bestRootMove, Index childPv) {
+    Index set(Ply depth, Score score, Move bestRootMove, Index childPv, Bound bound = ExactBound) {
         depth_ = depth;
         score_ = score;
+        bound_ = bound;
         return set(Index{0}, bestRootMove, childPv);
     }
 
@@ -197,10 +264,14 @@ public:
 
     void set(Ply depth) { depth_ = depth; }
 
+    // root fail low, keep the PV moves, but report the upper bound score
+    void set(Score score, Bound bound) { score_ = score; bound_ = bound; }
+
     const auto* moves() const { return &pv_[Index{0}]; }
     auto getMove(Ply ply) const { return pv_[Index{+ply}]; }
     auto depth() const { return depth_; }
     auto score() const { return score_; }
+    auto bound() const { return bound_; }
 };
 
 template <int Size>
@@ -1,6 +1,7 @@
 #include "common.hpp"
 #include "io.hpp"
 #include "Bb.hpp"
+#include "Cpu.hpp"
 #include "Hyperbola.hpp"
 #include "PiMask.hpp"
 #include "Score.hpp"
@@ -82,6 +83,8 @@ ostream& io::app_version(ostream& os) {
         os << ' ' << GIT_SHA;
 #endif
 
+    os << ' ' << Cpu::isa() << ' ' << Cpu::sliders();
+
 #ifndef NDEBUG
         os << " DEBUG";
 #endif
@@ -94,9 +97,38 @@ int main(int argc, const char* argv[]) {
     bool runBench = false;
     std::string benchLimits;
 
+    // the best kernels available on the host CPU
+    Cpu::select(Cpu::supported());
+
     for (int i = 1; i < argc; ++i) {
         std::string_view option{argv[i]};
 
+        if (option == "--isa") {
+            if (++i >= argc) {
+                std::cerr << "petrel: option '" << option << "' requires an instruction set name\n";
+                return EXIT_FAILURE;
+            }
+
+            if (!Cpu::select(argv[i])) {
+                std::cerr << "petrel: unsupported instruction set: " << argv[i] << ", supported up to " << Cpu::supported() << '\n';
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+
+        if (option == "--sliders") {
+            if (++i >= argc) {
+                std::cerr << "petrel: option '" << option << "' requires a sliding attacks backend name\n";
+                return EXIT_FAILURE;
+            }
+
+            if (!Cpu::selectSliders(argv[i])) {
+                std::cerr << "petrel: unsupported sliding attacks backend: " << argv[i] << ", instruction set " << Cpu::isa() << '\n';
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+
         if (option == "--file" || option == "-f") {
             if (++i >= argc) {
                 std::cerr << "petrel: option '" << option << "' requires a filename\n";
@@ -129,6 +161,8 @@ int main(int argc, const char* argv[]) {
                 << "\nOptions:\n"
                 << "    -f|--file [FILE]                Read and execute initial UCI commands from the specified file.\n"
                 << "    -b|--bench|bench [GO LIMITS]    Search a set of benchmark positions, report total nodes and nps, and exit.\n"
+                << "    --isa [NAME]                    Force kernels instruction set: generic, sse41, avx2 or avx512 (default is the best supported by CPU).\n"
+                << "    --sliders [NAME]                Sliding pieces attacks: hyperbola (default) or BMI2 pext tables (avx2 and avx512 only).\n"
                 << "    -v|--version                    Display version information and exit.\n"
                 << "    -h|--help                       Show this help message and exit.\n"
                 << "\n";
@@ -1,17 +1,580 @@
+#include <cstring>
+#include <initializer_list>
 #include "nnue.hpp"
+#include "System.hpp"
 
 #define INCBIN_PREFIX
 #define INCBIN_STYLE INCBIN_STYLE_SNAKE
 #define INCBIN_ALIGNMENT_INDEX 6
 #include "incbin.h"
 
-INCBIN(Nnue, incbin_nnue, "net/quantised.bin");
+INCBIN(Nnue::Embedded, incbin_nnue, "net/quantised.bin");
 
-constinit const Nnue& nnue = *incbin_nnue_data;
+constinit Nnue nnue;
+constinit Nnue smallNnue;
 
-void Nnue::validate_embedded_size() {
-    if (incbin_nnue_size != sizeof(Nnue)) {
-        std::cerr << "petrel: fatal error: invalid embedded NNUE file size: " << incbin_nnue_size << ", expected " << sizeof(Nnue) << " bytes\n";
+namespace {
+    using _t = Nnue::_t;
+    using WRow = Nnue::WRow;
+    using AccIndex = Nnue::AccIndex;
+    using DualAccIndex = Nnue::DualAccIndex;
+
+    // primary template is the portable kernels, compiled for the build target instruction set
+    // W is feature weights type: i16_t or i8_t (widened and scaled to QA while loading)
+    template <Isa::_t, int Acc_neurons, typename W>
+    struct Kernel {
+        static constexpr int Size = Acc_neurons / Nnue::Vector_size; // number of vectors in accumulator row
+
+        static _t load(WRow w, int i) {
+            if constexpr (sizeof(W) == 1) {
+                return __builtin_convertvector(static_cast<const i8x16_t*>(w)[i], i16x16_t);
+            } else {
+                return static_cast<const _t*>(w)[i];
+            }
+        }
+
+        static _t scale(_t v) {
+            if constexpr (sizeof(W) == 1) { return v << Nnue::I8_shift; } else { return v; }
+        }
+
+        static _t adds(_t a, _t b) { return adds_i16(a, b); }
+
+        static void move(_t* acc, const _t* parent, WRow add, WRow sub) {
+            for (int i = 0; i < Size; ++i) {
+                acc[i] = adds(parent[i], scale(load(add, i) - load(sub, i)));
+            }
+        }
+
+        static void capture(_t* acc, const _t* parent, WRow add, WRow sub1, WRow sub2) {
+            for (int i = 0; i < Size; ++i) {
+                acc[i] = adds(parent[i], scale(load(add, i) - load(sub1, i) - load(sub2, i)));
+            }
+        }
+
+        static void castle(_t* acc, const _t* parent, WRow add1, WRow sub1, WRow add2, WRow sub2) {
+            for (int i = 0; i < Size; ++i) {
+                auto s1 = load(add1, i) - load(sub1, i);
+                auto s2 = load(add2, i) - load(sub2, i);
+                acc[i] = adds(parent[i], scale(s1 + s2));
+            }
+        }
+
+        static void setup(_t* acc, const WRow rows[], int count) {
+            for (int i = 0; i < Size; ++i) {
+                _t a{};
+                for (int n = 0; n < count; ++n) {
+                    a = adds(a, scale(load(rows[n], i)));
+                }
+                acc[i] = a;
+            }
+        }
+
+        // vector index is the outer loop, so the same w0 column slice is reused by all accumulators
+        static void setupBatch(_t* const accs[], const WRow* const rows[], const int counts[], int count) {
+            for (int i = 0; i < Size; ++i) {
+                for (int b = 0; b < count; ++b) {
+                    _t a{};
+                    for (int n = 0; n < counts[b]; ++n) {
+                        a = adds(a, scale(load(rows[b][n], i)));
+                    }
+                    accs[b][i] = a;
+                }
+            }
+        }
+
+        // op accumulator output weights are at AccIndex::size() offset of W1 layout
+        static i64_t output(const _t* my, const _t* op, const _t* w1) {
+            i64x4_t sum4{};
+            for (auto acc : {my, op}) {
+                for (int i = 0; i < Size; ++i) {
+                    auto sum8 = Nnue::forward(acc[i], w1[i], w1[DualAccIndex::size() + i]);
+                    sum4 += unpack_add_i32(sum8);
+                }
+                w1 += AccIndex::size();
+            }
+            return hadd_i64(sum4);
+        }
+    };
+
+#if CPU_X86
+
+    // SSE4.1 kernels (x86-64-v2) process each accumulator vector as two 128-bit halves
+
+    template <int Acc_neurons, typename W>
+    struct Kernel<Sse41, Acc_neurons, W> {
+        static constexpr int Size = Acc_neurons / 8; // number of 128-bit vectors in accumulator row
+
+        static TARGET_SSE41 __m128i load(WRow w, int i) {
+            if constexpr (sizeof(W) == 1) {
+                auto p = static_cast<const char*>(w) + 8*i;
+                return _mm_cvtepi8_epi16(_mm_loadl_epi64(static_cast<const __m128i*>(static_cast<const void*>(p))));
+            } else {
+                return _mm_load_si128(static_cast<const __m128i*>(w) + i);
+            }
+        }
+
+        static TARGET_SSE41 __m128i scale(__m128i v) {
+            if constexpr (sizeof(W) == 1) { return _mm_slli_epi16(v, Nnue::I8_shift); } else { return v; }
+        }
+
+        static TARGET_SSE41 void move(_t* acc, const _t* parent, WRow add, WRow sub) {
+            auto a = reinterpret_cast<__m128i*>(acc);
+            auto p = reinterpret_cast<const __m128i*>(parent);
+
+            for (int i = 0; i < Size; ++i) {
+                auto s = _mm_sub_epi16(load(add, i), load(sub, i));
+                a[i] = _mm_adds_epi16(p[i], scale(s));
+            }
+        }
+
+        static TARGET_SSE41 void capture(_t* acc, const _t* parent, WRow add, WRow sub1, WRow sub2) {
+            auto a = reinterpret_cast<__m128i*>(acc);
+            auto p = reinterpret_cast<const __m128i*>(parent);
+
+            for (int i = 0; i < Size; ++i) {
+                auto s = _mm_sub_epi16(_mm_sub_epi16(load(add, i), load(sub1, i)), load(sub2, i));
+                a[i] = _mm_adds_epi16(p[i], scale(s));
+            }
+        }
+
+        static TARGET_SSE41 void castle(_t* acc, const _t* parent, WRow add1, WRow sub1, WRow add2, WRow sub2) {
+            auto a = reinterpret_cast<__m128i*>(acc);
+            auto p = reinterpret_cast<const __m128i*>(parent);
+
+            for (int i = 0; i < Size; ++i) {
+                auto s1 = _mm_sub_epi16(load(add1, i), load(sub1, i));
+                auto s2 = _mm_sub_epi16(load(add2, i), load(sub2, i));
+                a[i] = _mm_adds_epi16(p[i], scale(_mm_add_epi16(s1, s2)));
+            }
+        }
+
+        static TARGET_SSE41 void setup(_t* acc, const WRow rows[], int count) {
+            auto a = reinterpret_cast<__m128i*>(acc);
+
+            for (int i = 0; i < Size; ++i) {
+                __m128i v = _mm_setzero_si128();
+                for (int n = 0; n < count; ++n) {
+                    v = _mm_adds_epi16(v, scale(load(rows[n], i)));
+                }
+                a[i] = v;
+            }
+        }
+
+        static TARGET_SSE41 void setupBatch(_t* const accs[], const WRow* const rows[], const int counts[], int count) {
+            for (int i = 0; i < Size; ++i) {
+                for (int b = 0; b < count; ++b) {
+                    __m128i v = _mm_setzero_si128();
+                    for (int n = 0; n < counts[b]; ++n) {
+                        v = _mm_adds_epi16(v, scale(load(rows[b][n], i)));
+                    }
+                    reinterpret_cast<__m128i*>(accs[b])[i] = v;
+                }
+            }
+        }
+
+        static TARGET_SSE41 i64_t output(const _t* my, const _t* op, const _t* w1) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i one = _mm_set1_epi16(1);
+            const __m128i qa = _mm_set1_epi16(1024);
+
+            constexpr int Side_size = AccIndex::size() * 2; // op accumulator output weights offset in 128-bit vectors
+            auto pos = reinterpret_cast<const __m128i*>(w1);
+            auto neg = pos + 2*Side_size;
+
+            __m128i sum2 = _mm_setzero_si128();
+            for (auto acc : {my, op}) {
+                auto a = reinterpret_cast<const __m128i*>(acc);
+                for (int i = 0; i < Size; ++i) {
+                    __m128i x = a[i];
+
+                    // Squared Concatenated ReLU, see Nnue::forward()
+                    auto x1024 = _mm_min_epi16(_mm_max_epi16(_mm_abs_epi16(x), zero), qa);
+                    auto x2 = _mm_slli_epi16(x1024, 5);
+                    auto xx = _mm_mulhi_epu16(_mm_add_epi16(x2, one), x2);
+                    auto w = _mm_blendv_epi8(neg[i], pos[i], _mm_cmpgt_epi16(x, zero));
+                    auto sum4 = _mm_madd_epi16(xx, w);
+
+                    sum2 = _mm_add_epi64(sum2, _mm_cvtepi32_epi64(sum4));
+                    sum2 = _mm_add_epi64(sum2, _mm_cvtepi32_epi64(_mm_srli_si128(sum4, 8)));
+                }
+                pos += Side_size;
+                neg += Side_size;
+            }
+
+            return _mm_cvtsi128_si64(sum2) + _mm_extract_epi64(sum2, 1);
+        }
+    };
+
+    // AVX2 kernels, same saturating semantics as the portable kernels
+
+    template <int Acc_neurons, typename W>
+    struct Kernel<Avx2, Acc_neurons, W> {
+        static constexpr int Size = Acc_neurons / Nnue::Vector_size;
+
+        static TARGET_AVX2 __m256i load(WRow w, int i) {
+            if constexpr (sizeof(W) == 1) {
+                return _mm256_cvtepi8_epi16(_mm_load_si128(static_cast<const __m128i*>(w) + i));
+            } else {
+                return _mm256_load_si256(static_cast<const __m256i*>(w) + i);
+            }
+        }
+
+        static TARGET_AVX2 __m256i scale(__m256i v) {
+            if constexpr (sizeof(W) == 1) { return _mm256_slli_epi16(v, Nnue::I8_shift); } else { return v; }
+        }
+
+        static TARGET_AVX2 void move(_t* acc, const _t* parent, WRow add, WRow sub) {
+            for (int i = 0; i < Size; ++i) {
+                auto s = _mm256_sub_epi16(load(add, i), load(sub, i));
+                acc[i] = _mm256_adds_epi16(parent[i], scale(s));
+            }
+        }
+
+        static TARGET_AVX2 void capture(_t* acc, const _t* parent, WRow add, WRow sub1, WRow sub2) {
+            for (int i = 0; i < Size; ++i) {
+                auto s = _mm256_sub_epi16(_mm256_sub_epi16(load(add, i), load(sub1, i)), load(sub2, i));
+                acc[i] = _mm256_adds_epi16(parent[i], scale(s));
+            }
+        }
+
+        static TARGET_AVX2 void castle(_t* acc, const _t* parent, WRow add1, WRow sub1, WRow add2, WRow sub2) {
+            for (int i = 0; i < Size; ++i) {
+                auto s1 = _mm256_sub_epi16(load(add1, i), load(sub1, i));
+                auto s2 = _mm256_sub_epi16(load(add2, i), load(sub2, i));
+                acc[i] = _mm256_adds_epi16(parent[i], scale(_mm256_add_epi16(s1, s2)));
+            }
+        }
+
+        static TARGET_AVX2 void setup(_t* acc, const WRow rows[], int count) {
+            for (int i = 0; i < Size; ++i) {
+                __m256i a = _mm256_setzero_si256();
+                for (int n = 0; n < count; ++n) {
+                    a = _mm256_adds_epi16(a, scale(load(rows[n], i)));
+                }
+                acc[i] = a;
+            }
+        }
+
+        static TARGET_AVX2 void setupBatch(_t* const accs[], const WRow* const rows[], const int counts[], int count) {
+            for (int i = 0; i < Size; ++i) {
+                for (int b = 0; b < count; ++b) {
+                    __m256i a = _mm256_setzero_si256();
+                    for (int n = 0; n < counts[b]; ++n) {
+                        a = _mm256_adds_epi16(a, scale(load(rows[b][n], i)));
+                    }
+                    accs[b][i] = a;
+                }
+            }
+        }
+
+        static TARGET_AVX2 i64_t output(const _t* my, const _t* op, const _t* w1) {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i one = _mm256_set1_epi16(1);
+            const __m256i qa = _mm256_set1_epi16(1024);
+
+            __m256i sum4 = _mm256_setzero_si256();
+            for (auto acc : {my, op}) {
+                for (int i = 0; i < Size; ++i) {
+                    __m256i x = acc[i];
+
+                    // Squared Concatenated ReLU, see Nnue::forward()
+                    auto x1024 = _mm256_min_epi16(_mm256_max_epi16(_mm256_abs_epi16(x), zero), qa);
+                    auto x2 = _mm256_slli_epi16(x1024, 5);
+                    auto xx = _mm256_mulhi_epu16(_mm256_add_epi16(x2, one), x2);
+                    auto w = _mm256_blendv_epi8(w1[DualAccIndex::size() + i], w1[i], _mm256_cmpgt_epi16(x, zero));
+                    auto sum8 = _mm256_madd_epi16(xx, w);
+
+                    sum4 = _mm256_add_epi64(sum4, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(sum8)));
+                    sum4 = _mm256_add_epi64(sum4, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(sum8, 1)));
+                }
+                w1 += AccIndex::size();
+            }
+
+            auto sum2 = _mm_add_epi64(_mm256_castsi256_si128(sum4), _mm256_extracti128_si256(sum4, 1));
+            return _mm_cvtsi128_si64(sum2) + _mm_extract_epi64(sum2, 1);
+        }
+    };
+
+    // AVX-512 kernels process two accumulator vectors at once
+
+    template <int Acc_neurons, typename W>
+    struct Kernel<Avx512, Acc_neurons, W> {
+        static constexpr int Size = Acc_neurons / 32; // number of 512-bit vectors in accumulator row
+
+        static TARGET_AVX512 __m512i load(WRow w, int i) {
+            if constexpr (sizeof(W) == 1) {
+                return _mm512_cvtepi8_epi16(_mm256_loadu_si256(static_cast<const __m256i*>(w) + i));
+            } else {
+                return _mm512_loadu_si512(static_cast<const __m512i*>(w) + i);
+            }
+        }
+
+        static TARGET_AVX512 __m512i scale(__m512i v) {
+            if constexpr (sizeof(W) == 1) { return _mm512_slli_epi16(v, Nnue::I8_shift); } else { return v; }
+        }
+
+        static TARGET_AVX512 void move(_t* acc, const _t* parent, WRow add, WRow sub) {
+            auto a = reinterpret_cast<__m512i*>(acc);
+            auto p = reinterpret_cast<const __m512i*>(parent);
+
+            for (int i = 0; i < Size; ++i) {
+                auto s = _mm512_sub_epi16(load(add, i), load(sub, i));
+                _mm512_storeu_si512(a+i, _mm512_adds_epi16(_mm512_loadu_si512(p+i), scale(s)));
+            }
+        }
+
+        static TARGET_AVX512 void capture(_t* acc, const _t* parent, WRow add, WRow sub1, WRow sub2) {
+            auto a = reinterpret_cast<__m512i*>(acc);
+            auto p = reinterpret_cast<const __m512i*>(parent);
+
+            for (int i = 0; i < Size; ++i) {
+                auto s = _mm512_sub_epi16(_mm512_sub_epi16(load(add, i), load(sub1, i)), load(sub2, i));
+                _mm512_storeu_si512(a+i, _mm512_adds_epi16(_mm512_loadu_si512(p+i), scale(s)));
+            }
+        }
+
+        static TARGET_AVX512 void castle(_t* acc, const _t* parent, WRow add1, WRow sub1, WRow add2, WRow sub2) {
+            auto a = reinterpret_cast<__m512i*>(acc);
+            auto p = reinterpret_cast<const __m512i*>(parent);
+
+            for (int i = 0; i < Size; ++i) {
+                auto s1 = _mm512_sub_epi16(load(add1, i), load(sub1, i));
+                auto s2 = _mm512_sub_epi16(load(add2, i), load(sub2, i));
+                _mm512_storeu_si512(a+i, _mm512_adds_epi16(_mm512_loadu_si512(p+i), scale(_mm512_add_epi16(s1, s2))));
+            }
+        }
+
+        static TARGET_AVX512 void setup(_t* acc, const WRow rows[], int count) {
+            auto a = reinterpret_cast<__m512i*>(acc);
+
+            for (int i = 0; i < Size; ++i) {
+                __m512i v = _mm512_setzero_si512();
+                for (int n = 0; n < count; ++n) {
+                    v = _mm512_adds_epi16(v, scale(load(rows[n], i)));
+                }
+                _mm512_storeu_si512(a+i, v);
+            }
+        }
+
+        static TARGET_AVX512 void setupBatch(_t* const accs[], const WRow* const rows[], const int counts[], int count) {
+            for (int i = 0; i < Size; ++i) {
+                for (int b = 0; b < count; ++b) {
+                    __m512i v = _mm512_setzero_si512();
+                    for (int n = 0; n < counts[b]; ++n) {
+                        v = _mm512_adds_epi16(v, scale(load(rows[b][n], i)));
+                    }
+                    _mm512_storeu_si512(reinterpret_cast<__m512i*>(accs[b]) + i, v);
+                }
+            }
+        }
+
+        static TARGET_AVX512 i64_t output(const _t* my, const _t* op, const _t* w1) {
+            const __m512i zero = _mm512_setzero_si512();
+            const __m512i one = _mm512_set1_epi16(1);
+            const __m512i qa = _mm512_set1_epi16(1024);
+
+            constexpr int Side_size = AccIndex::size() / 2; // op accumulator output weights offset in 512-bit vectors
+            auto pos = reinterpret_cast<const __m512i*>(w1);
+            auto neg = pos + 2*Side_size;
+
+            __m512i sum8 = _mm512_setzero_si512();
+            for (auto acc : {my, op}) {
+                auto a = reinterpret_cast<const __m512i*>(acc);
+                for (int i = 0; i < Size; ++i) {
+                    auto x = _mm512_loadu_si512(a+i);
+
+                    // Squared Concatenated ReLU, see Nnue::forward()
+                    auto x1024 = _mm512_min_epi16(_mm512_max_epi16(_mm512_abs_epi16(x), zero), qa);
+                    auto x2 = _mm512_slli_epi16(x1024, 5);
+                    auto xx = _mm512_mulhi_epu16(_mm512_add_epi16(x2, one), x2);
+                    auto w = _mm512_mask_blend_epi16(_mm512_cmpgt_epi16_mask(x, zero), _mm512_loadu_si512(neg+i), _mm512_loadu_si512(pos+i));
+                    auto sum16 = _mm512_madd_epi16(xx, w);
+
+                    sum8 = _mm512_add_epi64(sum8, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(sum16)));
+                    sum8 = _mm512_add_epi64(sum8, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(sum16, 1)));
+                }
+                pos += Side_size;
+                neg += Side_size;
+            }
+
+            return _mm512_reduce_add_epi64(sum8);
+        }
+    };
+
+#endif // CPU_X86
+
+    template <Isa::_t I, int Acc_neurons, typename W>
+    constexpr Nnue::Kernels kernelsOf() {
+        using K = Kernel<I, Acc_neurons, W>;
+        return { K::move, K::capture, K::castle, K::setup, K::setupBatch, K::output };
+    }
+
+    template <int Acc_neurons, typename W>
+    constexpr array<Nnue::Kernels, Isa> The_kernels {
+        kernelsOf<Generic, Acc_neurons, W>(),
+        kernelsOf<Sse41, Acc_neurons, W>(),
+        kernelsOf<Avx2, Acc_neurons, W>(),
+        kernelsOf<Avx512, Acc_neurons, W>(),
+    };
+
+    // EvalFile header, followed by W0 (feature weights), W1 (output weights) and b1 (output bias)
+    struct Header {
+        enum inputs_t : u32_t { Chess768, Chess768hm };
+        enum activation_t : u32_t { SCReLU, SCReLU_PosNeg };
+        enum weights_t : u32_t { W0_i16, W0_i8 };
+
+        static constexpr char The_magic[8] = {'p','e','t','r','e','l','n','n'};
+        static constexpr u32_t The_version = 1;
+
+        char magic[8];
+        u32_t version;
+        u32_t accNeurons; // 128 or 1024
+        u32_t inputs; // Chess768hm: horizontal mirroring by king file
+        u32_t activation; // SCReLU_PosNeg: separate output weights for positive and negative accumulator values
+        u32_t qa; // accumulator quantisation, must be 1024 (hardcoded SCReLU clamp)
+        u32_t qb; // output weights quantisation, power of 2
+        u32_t weights; // W0_i8: feature weights quantised by QA/16 (1 byte each)
+        u32_t reserved[7];
+    };
+    static_assert (sizeof(Header) == 64);
+}
+
+void NnueBatch::evaluate(int32_t result[]) {
+    std::array<_t*, 2*Max_size> accs;
+    std::array<const WRow*, 2*Max_size> rows;
+    for (int a = 0; a < 2*size_; ++a) {
+        accs[a] = &acc_[a * Nnue::AccIndex::size()];
+        rows[a] = rows_[a].data();
+    }
+
+    net.kernels().setupBatch(accs.data(), rows.data(), rowCount_.data(), 2*size_);
+
+    // output weights stay in cache for the whole batch
+    for (int p = 0; p < size_; ++p) {
+        result[p] = net.evaluate(accs[2*p], accs[2*p + 1]);
+    }
+}
+
+void Nnue::setEmbedded() {
+    if (incbin_nnue_size != sizeof(Embedded)) {
+        std::cerr << "petrel: fatal error: invalid embedded NNUE file size: " << incbin_nnue_size << ", expected " << sizeof(Embedded) << " bytes\n";
         std::exit(EXIT_FAILURE);
     }
+
+    unmap();
+
+    // one time copy into huge pages: random feature rows access of the 2MB+ network thrashes 4K pages TLB
+    static const Embedded* const embeddedCopy = [] {
+        auto copy = static_cast<Embedded*>(System::allocateHugePages(sizeof(Embedded)));
+        if (copy) { std::memcpy(copy, incbin_nnue_data, sizeof(Embedded)); }
+        return copy ? copy : incbin_nnue_data;
+    }();
+
+    auto& embedded = *embeddedCopy;
+    w0_ = reinterpret_cast<const char*>(&embedded.w0);
+    w1_ = embedded.w1[HIndex{Pos}].data();
+    b1_ = &embedded.b1;
+    accNeurons_ = Max_neurons;
+    rowBytes_ = Max_neurons * sizeof(i16_t);
+    int8_ = false;
+    scale_ = 18;
+    mirrored_ = true;
+    selectKernels();
+}
+
+io::czstring Nnue::load(const std::string& fileName, int maxNeurons) {
+    size_t size = 0;
+    auto data = static_cast<const char*>(System::mapFile(fileName, size));
+    if (!data) { return "failed opening EvalFile: "; }
+
+    auto fail = [&](io::czstring message) {
+        System::unmapFile(data, size);
+        return message;
+    };
+
+    if (size < sizeof(Header)) { return fail("invalid EvalFile size: "); }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+    size_t headerSize = sizeof(Header);
+
+    if (std::memcmp(header.magic, Header::The_magic, sizeof(Header::The_magic)) != 0) {
+        if (size != sizeof(Embedded)) { return fail("invalid EvalFile header: "); }
+
+        // headerless file of the embedded network architecture
+        header = { {}, Header::The_version, Max_neurons, Header::Chess768hm, Header::SCReLU_PosNeg, 1024, 16, Header::W0_i16, {} };
+        headerSize = 0;
+    }
+
+    if (header.version != Header::The_version) { return fail("unsupported EvalFile version: "); }
+
+    auto n = header.accNeurons;
+    if ((n != Small_neurons && n != Max_neurons) || static_cast<int>(n) > maxNeurons) { return fail("unsupported EvalFile accumulator size: "); }
+    if (header.inputs != Header::Chess768 && header.inputs != Header::Chess768hm) { return fail("unsupported EvalFile inputs: "); }
+    if (header.activation != Header::SCReLU && header.activation != Header::SCReLU_PosNeg) { return fail("unsupported EvalFile activation: "); }
+    if (header.qa != 1024 || !std::has_single_bit(header.qb) || header.qb > (1u << 14)) { return fail("unsupported EvalFile quantisation: "); }
+    if (header.weights != Header::W0_i16 && header.weights != Header::W0_i8) { return fail("unsupported EvalFile weights type: "); }
+
+    int heads = header.activation == Header::SCReLU_PosNeg ? 2 : 1;
+    size_t rowBytes = (header.weights == Header::W0_i8 ? sizeof(i8_t) : sizeof(i16_t)) * n;
+    size_t w0Size = rowBytes * FeatureIndex::size();
+    size_t w1Size = sizeof(i16_t) * heads * 2*n;
+    if (size < headerSize + w0Size + w1Size + sizeof(i64_t)) { return fail("invalid EvalFile size: "); }
+
+    auto w0 = data + headerSize;
+    auto w1 = w0 + w0Size;
+    auto b1 = w1 + w1Size;
+
+    // convert output weights into W1 layout: [Pos|Neg][my accumulator (Max_neurons)|op accumulator (Max_neurons)]
+    W1 paddedW1{};
+    auto padded = reinterpret_cast<i16_t*>(&paddedW1);
+    for (int h = 0; h < heads; ++h) {
+        for (int side = 0; side < 2; ++side) {
+            std::memcpy(padded + (h*2 + side) * Max_neurons, w1 + (h*2 + side) * n * sizeof(i16_t), n * sizeof(i16_t));
+        }
+    }
+
+    unmap();
+    mapping_ = data;
+    mappingSize_ = size;
+
+    paddedW1_ = paddedW1;
+    w0_ = w0;
+    w1_ = paddedW1_[HIndex{Pos}].data();
+    b1_ = reinterpret_cast<const i64_t*>(b1);
+    accNeurons_ = static_cast<int>(n);
+    rowBytes_ = static_cast<int>(rowBytes);
+    int8_ = header.weights == Header::W0_i8;
+    scale_ = 10 + 4 + std::countr_zero(header.qb); // QA=1024, squared=16, QB
+    mirrored_ = header.inputs == Header::Chess768hm;
+    selectKernels();
+    return nullptr;
+}
+
+void Nnue::clear() {
+    unmap();
+    w0_ = nullptr;
+    w1_ = nullptr;
+    b1_ = nullptr;
+}
+
+void Nnue::unmap() {
+    if (mapping_) {
+        System::unmapFile(mapping_, mappingSize_);
+        mapping_ = nullptr;
+        mappingSize_ = 0;
+    }
+}
+
+void Nnue::selectKernels() {
+    if (accNeurons_ == Max_neurons) {
+        kernels_ = int8_ ? The_kernels<Max_neurons, i8_t>[isa_] : The_kernels<Max_neurons, i16_t>[isa_];
+    } else {
+        kernels_ = int8_ ? The_kernels<Small_neurons, i8_t>[isa_] : The_kernels<Small_neurons, i16_t>[isa_];
+    }
+}
+
+void Nnue::selectKernels(Isa isa) {
+    isa_ = isa;
+    selectKernels();
 }
@@ -2,8 +2,10 @@
 #define NNUE_HPP
 
 #include "bitops256.hpp"
+#include "Cpu.hpp"
 #include "Index.hpp"
 
+using i8x16_t  = i8_t __attribute__((vector_size(16)));
 using i16x16_t = i16_t __attribute__((vector_size(32)));
 using u16x16_t = u16_t __attribute__((vector_size(32)));
 using i32x8_t  = i32_t __attribute__((vector_size(32)));
@@ -42,9 +44,27 @@ constexpr i16x16_t clamp(i16x16_t a, int b, int c) {
     return min(max(a, i16x16x(b)), i16x16x(c));
 }
 
+#if !USE_AVX2 && defined(__SSE2__)
+    #define USE_SSE2 1
+    #include <emmintrin.h>
+
+    // apply 128-bit SSE2 operation to both halves of 256-bit vectors (SSE2 is x86-64 baseline)
+    template <typename R, typename V>
+    inline R sse2x2(V a, V b, auto&& op) {
+        using Halves = std::array<__m128i, 2>;
+        auto x = std::bit_cast<Halves>(a);
+        auto y = std::bit_cast<Halves>(b);
+        return std::bit_cast<R>(Halves{ op(x[0], y[0]), op(x[1], y[1]) });
+    }
+#else
+    #define USE_SSE2 0
+#endif
+
 inline u16x16_t mulhi_u16(u16x16_t a, u16x16_t b) {
     #if USE_AVX2
         return _mm256_mulhi_epu16(a, b);
+    #elif USE_SSE2
+        return sse2x2<u16x16_t>(a, b, [](__m128i x, __m128i y) { return _mm_mulhi_epu16(x, y); });
     #else
         u16x16_t res{};
         for (int i = 0; i < 16; ++i) {
@@ -54,6 +74,22 @@ inline u16x16_t mulhi_u16(u16x16_t a, u16x16_t b) {
     #endif
 }
 
+// saturating add, accumulators stay identical with any instruction set
+inline i16x16_t adds_i16(i16x16_t a, i16x16_t b) {
+    #if USE_AVX2
+        return _mm256_adds_epi16(a, b);
+    #elif USE_SSE2
+        return sse2x2<i16x16_t>(a, b, [](__m128i x, __m128i y) { return _mm_adds_epi16(x, y); });
+    #else
+        i16x16_t res{};
+        for (int i = 0; i < 16; ++i) {
+            auto sum = static_cast<i32_t>(a[i]) + static_cast<i32_t>(b[i]);
+            res[i] = static_cast<i16_t>(std::clamp<i32_t>(sum, INT16_MIN, INT16_MAX));
+        }
+        return res;
+    #endif
+}
+
 inline i64x4_t unpack_add_i32(i32x8_t a) {
     // signed extension from i32 to i64
     i64x4_t low = __builtin_convertvector(__builtin_shufflevector(a, a, 0, 1, 2, 3), i64x4_t);
@@ -72,6 +108,8 @@ inline i64_t hadd_i64(i64x4_t sum4) {
 inline i32x8_t madd_i16(i16x16_t w, i16x16_t v) {
     #if USE_AVX2
         return _mm256_madd_epi16(w, v);
+    #elif USE_SSE2
+        return sse2x2<i32x8_t>(w, v, [](__m128i x, __m128i y) { return _mm_madd_epi16(x, y); });
     #else
         i32x8_t sum{};
         for (int i = 0; i < 8; ++i) {
@@ -82,7 +120,8 @@ inline i32x8_t madd_i16(i16x16_t w, i16x16_t v) {
     #endif
 }
 
-struct CACHE_ALIGN Nnue {
+class Nnue {
+public:
     struct FeatureIndex : ::Index<FeatureIndex, 2*6*64> { using Index::Index;
         constexpr FeatureIndex (Side si, PieceType ty, Square sq, Square mirror)
             : Index{ (+si * 6*64) + (+ty * 64) + +(sq ^ mirror) }
@@ -91,9 +130,11 @@ struct CACHE_ALIGN Nnue {
 
     using _t = i16x16_t;
     static constexpr int Vector_size = sizeof(_t) / sizeof(i16_t);
-    static constexpr int Acc_neurons = 1024;
+    static constexpr int Max_neurons = 1024; // the widest supported accumulator
+    static constexpr int Small_neurons = 128; // the narrowest supported accumulator (EvalFileSmall)
+    static constexpr int I8_shift = 4; // int8 feature weights are quantised by QA/16 and widened to QA scale
 
-    struct AccIndex : Index<AccIndex, Acc_neurons / Vector_size> { using Index::Index; };
+    struct AccIndex : Index<AccIndex, Max_neurons / Vector_size> { using Index::Index; };
     struct DualAccIndex : Index<DualAccIndex, 2*AccIndex::size()> { using Index::Index; };
 
     enum activation_enum { Pos, Neg };
@@ -102,9 +143,12 @@ struct CACHE_ALIGN Nnue {
     using W0 = array<_t, FeatureIndex, AccIndex>;
     using W1 = array<_t, HIndex, DualAccIndex>;
 
-    W0 w0;    // feature weights, feature biases embeded into kings weights
-    W1 w1;    // output weights
-    i64_t b1; // output bias (64 byte aligned), total = 2'371648 bytes
+    // headerless network file embedded into executable: (768hm->1024)x2->1, SCReLU pos/neg heads, QA=1024, QB=16
+    struct CACHE_ALIGN Embedded {
+        W0 w0;    // feature weights, feature biases embeded into kings weights
+        W1 w1;    // output weights
+        i64_t b1; // output bias (64 byte aligned), total = 2'371648 bytes
+    };
 
     static constexpr u16x16_t squared(u16x16_t x1024) {
         auto x2 = x1024 << 5; // 2*x [0 .. 32768]
@@ -117,160 +161,239 @@ struct CACHE_ALIGN Nnue {
         return madd_i16(xx, x > 0 ? pos : neg);
     }
 
-    using DualAcc = array<_t, DualAccIndex>;
-    int32_t evaluate(const DualAcc& acc) const {
-        i64x4_t sum4{};
-        for (auto i : range<DualAccIndex>()) {
-            auto sum8 = forward(acc[i], this->w1[HIndex{Pos}][i], this->w1[HIndex{Neg}][i]);
-            sum4 += unpack_add_i32(sum8);
-        }
-        i64_t output = this->b1 + hadd_i64(sum4);
+    // feature weights row, i16 or i8 (widened while loading) elements depending on the network
+    using WRow = const void*;
+
+    // accumulator updates from the parent accumulator and output layer,
+    // compiled for each instruction set, accumulator width and feature weights type
+    struct Kernels {
+        void (*move)(_t* acc, const _t* parent, WRow add, WRow sub);
+        void (*capture)(_t* acc, const _t* parent, WRow add, WRow sub1, WRow sub2);
+        void (*castle)(_t* acc, const _t* parent, WRow add1, WRow sub1, WRow add2, WRow sub2);
+        void (*setup)(_t* acc, const WRow rows[], int count);
+        void (*setupBatch)(_t* const accs[], const WRow* const rows[], const int counts[], int count);
+        i64_t (*output)(const _t* my, const _t* op, const _t* w1); // w1 dot product of activated accumulators
+    };
 
-        constexpr auto Scale = 18; // 10+4+4 (QA=1024, QB=16, squared=16)
-        auto result = output >> Scale;
-        return result;
+private:
+    const char* w0_ = nullptr; // feature weights rows
+    const _t* w1_ = nullptr; // output weights in W1 layout
+    const i64_t* b1_ = nullptr; // output bias
+    int accNeurons_ = Max_neurons;
+    int rowBytes_ = Max_neurons * sizeof(i16_t); // feature weights row stride
+    bool int8_ = false; // i8 feature weights
+    int scale_ = 18; // 10+4+4 (QA=1024, QB=16, squared=16)
+    bool mirrored_ = true; // Chess768hm: horizontal mirroring by king file
+    Isa isa_{Generic};
+    Kernels kernels_{};
+
+    W1 paddedW1_{}; // output weights of narrower or positive only networks converted into W1 layout
+    const void* mapping_ = nullptr; // memory mapped EvalFile, shared between processes via page cache
+    size_t mappingSize_ = 0;
+
+    void selectKernels();
+    void unmap();
+
+public:
+    constexpr Nnue() = default;
+    Nnue (const Nnue&) = delete;
+    Nnue& operator = (const Nnue&) = delete;
+
+    bool isLoaded() const { return w0_ != nullptr; }
+    int accSize() const { return accNeurons_ / Vector_size; } // number of vectors in an accumulator
+
+    const Kernels& kernels() const { return kernels_; }
+    WRow w0(FeatureIndex fi) const { return w0_ + +fi * rowBytes_; }
+
+    // king file dependent feature squares transformation
+    Square mirrorMask(Square sqKing) const { return mirrored_ ? sqKing.mirrorMask() : Square{static_cast<Square::_t>(0)}; }
+
+    // king move needs accumulator refresh (crossed the middle line of mirrored network)
+    bool isMirrorChanged(Square from, Square to) const { return mirrored_ && (+(from ^ to) & 4); }
+
+    int32_t evaluate(const _t* my, const _t* op) const {
+        i64_t output = *b1_ + kernels_.output(my, op, w1_);
+        auto result = output >> scale_;
+        return static_cast<int32_t>(result);
     }
 
-    static COLD void validate_embedded_size();
+    // switch to the embedded network, no copy
+    COLD void setEmbedded();
+
+    // unload network (small network is optional)
+    COLD void clear();
+
+    // memory map network file with header, return error message prefix or nullptr on success
+    COLD io::czstring load(const std::string& fileName, int maxNeurons = Max_neurons);
+
+    void selectKernels(Isa);
 };
 
-extern constinit const Nnue& nnue;
+extern constinit Nnue nnue; // main network, embedded by default
+extern constinit Nnue smallNnue; // optional small network for shallow nodes
 
 class Position;
 
+// single side perspective accumulator of the network up to Neurons wide
+template <int Neurons>
 class CACHE_ALIGN Acc {
 public:
     using Fi = Nnue::FeatureIndex;
-    using AccIndex = Nnue::AccIndex;
     using _t = Nnue::_t; // i16x16_t
 
-    static constexpr void swap(Acc& my, Acc& op) {
-        for (auto i : range<AccIndex>()) {
-            std::swap(my.acc[i], op.acc[i]);
-        }
-    }
+    struct AccIndex : ::Index<AccIndex, Neurons / Nnue::Vector_size> { using ::Index<AccIndex, Neurons / Nnue::Vector_size>::Index; };
 
-    // defined in Position.cpp
+    constexpr const _t* data() const { return acc.data(); }
+
+    // defined in Position_impl.hpp
     template <Side::_t>
-    void setup(const Position& pos, Square mirror);
+    void setup(const Nnue&, const Position& pos, Square mirror);
 
-    constexpr void move(Square mirror, Side si, PieceType ty, Square from, Square to) {
-        move({si, ty, from, mirror}, {si, ty, to, mirror});
+    void copy(const Nnue& net, const Acc& parent) {
+        std::copy_n(parent.acc.data(), net.accSize(), acc.data());
     }
 
-    constexpr void promote(Square mirror, Side si, Square from, PromoType promoted, Square to) {
-        move({si, Pawn, from, mirror}, {si, promoted, to, mirror});
+    void move(const Nnue& net, const Acc& parent, Square mirror, Side si, PieceType ty, Square from, Square to) {
+        move(net, parent, {si, ty, from, mirror}, {si, ty, to, mirror});
     }
 
-    constexpr void move(Square mirror, Side si, PieceType ty, Square from, Square to, NonKingType captured) {
-        capture({si, ty, from, mirror}, {si, ty, to, mirror}, {~si, captured, to, mirror});
+    void promote(const Nnue& net, const Acc& parent, Square mirror, Side si, Square from, PieceType promoted, Square to) {
+        move(net, parent, {si, Pawn, from, mirror}, {si, promoted, to, mirror});
     }
 
-    constexpr void promote(Square mirror, Side si, Square from, PromoType promoted, Square to, NonKingType captured) {
-        capture({si, Pawn, from, mirror}, {si, promoted, to, mirror}, {~si, captured, to, mirror});
+    void move(const Nnue& net, const Acc& parent, Square mirror, Side si, PieceType ty, Square from, Square to, NonKingType captured) {
+        capture(net, parent, {si, ty, from, mirror}, {si, ty, to, mirror}, {~si, captured, to, mirror});
     }
 
-    constexpr void ep(Square mirror, Side si, Square from, Square to, Square ep) {
-        capture({si, Pawn, from, mirror}, {si, Pawn, to, mirror}, {~si, Pawn, ep, mirror});
+    void promote(const Nnue& net, const Acc& parent, Square mirror, Side si, Square from, PieceType promoted, Square to, NonKingType captured) {
+        capture(net, parent, {si, Pawn, from, mirror}, {si, promoted, to, mirror}, {~si, captured, to, mirror});
     }
 
-    constexpr void castle(Square mirror, Side si, Square kingFrom, Square kingTo, Square rookFrom, Square rookTo) {
-        for (auto i : range<AccIndex>()) {
-            auto s1 = nnue.w0[{si, King, kingTo, mirror}][i] - nnue.w0[{si, King, kingFrom, mirror}][i];
-            auto s2 = nnue.w0[{si, Rook, rookTo, mirror}][i] - nnue.w0[{si, Rook, rookFrom, mirror}][i];
-            #if USE_AVX2
-                acc[i] = _mm256_adds_epi16(acc[i], s1 + s2);
-            #else
-                acc[i] += s1 + s2;
-            #endif
-        }
+    void ep(const Nnue& net, const Acc& parent, Square mirror, Side si, Square from, Square to, Square ep) {
+        capture(net, parent, {si, Pawn, from, mirror}, {si, Pawn, to, mirror}, {~si, Pawn, ep, mirror});
+    }
+
+    void castle(const Nnue& net, const Acc& parent, Square mirror, Side si, Square kingFrom, Square kingTo, Square rookFrom, Square rookTo) {
+        net.kernels().castle(acc.data(), parent.acc.data(),
+            net.w0({si, King, kingTo, mirror}), net.w0({si, King, kingFrom, mirror}),
+            net.w0({si, Rook, rookTo, mirror}), net.w0({si, Rook, rookFrom, mirror})
+        );
     }
 
 private:
     array<_t, AccIndex> acc{}; // feature biases = 0
 
-    constexpr void move(Fi from, Fi to) {
-        for (auto i : range<AccIndex>()) {
-            #if USE_AVX2
-                acc[i] = _mm256_adds_epi16(acc[i], nnue.w0[to][i] - nnue.w0[from][i]);
-            #else
-                acc[i] += nnue.w0[to][i] - nnue.w0[from][i];
-            #endif
-        }
+    void move(const Nnue& net, const Acc& parent, Fi from, Fi to) {
+        net.kernels().move(acc.data(), parent.acc.data(), net.w0(to), net.w0(from));
     }
 
-    constexpr void capture(Fi from, Fi to, Fi cap) {
-        for (auto i : range<AccIndex>()) {
-            #if USE_AVX2
-                acc[i] = _mm256_adds_epi16(acc[i], nnue.w0[to][i] - nnue.w0[from][i] - nnue.w0[cap][i]);
-            #else
-                acc[i] += nnue.w0[to][i] - nnue.w0[from][i] - nnue.w0[cap][i];
-            #endif
-        }
+    void capture(const Nnue& net, const Acc& parent, Fi from, Fi to, Fi cap) {
+        net.kernels().capture(acc.data(), parent.acc.data(), net.w0(to), net.w0(from), net.w0(cap));
     }
 };
 
-class DualAcc {
-public:
-    using _t = Acc::_t;
+// features change of the last move, recorded by Position::makeMove() and applied to accumulators on demand
+struct AccUpdate {
+    enum kind_t { NullMove, PieceMove, PieceCapture, Promotion, PromotionCapture, EnPassant, KingMove, KingCapture, Castling };
+
+    kind_t kind{NullMove};
+    PieceType ty{Pawn}; // moved or promoted piece type
+    NonKingType captured{};
+    Square from{};
+    Square to{};
+    Square from2{}; // en passant captured pawn or castling rook from
+    Square to2{}; // castling rook to
+
+    void move(PieceType _ty, Square _from, Square _to) {
+        assert (_from != _to);
+        *this = { PieceMove, _ty, {}, _from, _to };
+    }
 
-    // raw NNUE static evaluation
-    auto evaluate() const { return nnue.evaluate(std::bit_cast<Nnue::DualAcc>(side)); }
+    void move(PieceType _ty, Square _from, Square _to, NonKingType _captured) {
+        assert (_from != _to);
+        *this = { PieceCapture, _ty, _captured, _from, _to };
+    }
 
-    // defined in Position.cpp
-    void setup(const Position& pos);
-
-    // copy parent accumulator but flip sides
-    constexpr void flip(const DualAcc& parent) {
-        side[My] = parent.side[Op];
-        side[Op] = parent.side[My];
-        mirror[My] = parent.mirror[Op];
-        mirror[Op] = parent.mirror[My];
+    void promote(Square _from, PromoType promoted, Square _to) {
+        assert (_from.on(Rank7)); assert (_to.on(Rank8));
+        *this = { Promotion, promoted, {}, _from, _to };
     }
 
-    constexpr void swap() {
-        Acc::swap(side[My], side[Op]);
-        std::swap(mirror[My], mirror[Op]);
+    void promote(Square _from, PromoType promoted, Square _to, NonKingType _captured) {
+        assert (_from.on(Rank7)); assert (_to.on(Rank8));
+        *this = { PromotionCapture, promoted, _captured, _from, _to };
     }
 
-    constexpr void move(PieceType ty, Square from, Square to) {
-        assert (from != to);
-        side[Op].move(mirror[Op], My, ty, from, to);
-        side[My].move(~mirror[My], Op, ty, from, to);
+    void ep(Square _from, Square _to, Square _ep) {
+        assert (_from.on(Rank5)); assert (_to.on(Rank6)); assert (_ep.on(Rank5));
+        *this = { EnPassant, Pawn, {}, _from, _to, _ep };
     }
 
-    constexpr void move(PieceType ty, Square from, Square to, NonKingType captured) {
-        assert (from != to);
-        side[Op].move(mirror[Op], My, ty, from, to, captured);
-        side[My].move(~mirror[My], Op, ty, from, to, captured);
+    void moveKing(Square _from, Square _to) {
+        assert (_from != _to);
+        *this = { KingMove, King, {}, _from, _to };
     }
 
-    constexpr void promote(Square from, PromoType promoted, Square to) {
-        assert (from.on(Rank7)); assert (to.on(Rank8));
-        side[Op].promote(mirror[Op], My, from, promoted, to);
-        side[My].promote(~mirror[My], Op, from, promoted, to);
+    void moveKing(Square _from, Square _to, NonKingType _captured) {
+        assert (_from != _to);
+        *this = { KingCapture, King, _captured, _from, _to };
     }
 
-    constexpr void promote(Square from, PromoType promoted, Square to, NonKingType captured) {
-        assert (from.on(Rank7)); assert (to.on(Rank8));
-        side[Op].promote(mirror[Op], My, from, promoted, to, captured);
-        side[My].promote(~mirror[My], Op, from, promoted, to, captured);
+    void castle(Square kingFrom, Square kingTo, Square rookFrom, Square rookTo) {
+        assert (kingFrom != rookFrom); assert (kingTo != rookTo);
+        assert (kingFrom.on(Rank1)); assert (rookTo.on(Rank1));
+        *this = { Castling, King, {}, kingFrom, kingTo, rookFrom, rookTo };
     }
+};
 
-    constexpr void ep(Square from, Square to, Square ep) {
-        assert (from.on(Rank5)); assert (to.on(Rank6)); assert (ep.on(Rank5));
-        side[Op].ep(mirror[Op], My, from, to, ep);
-        side[My].ep(~mirror[My], Op, from, to, ep);
+// pair of accumulators from each side perspective, lazily updated from the parent position accumulators
+// (the computed flag is kept by the Position, so the cold accumulators are not touched by the node setup)
+template <int Neurons>
+class DualAcc {
+public:
+    // raw NNUE static evaluation
+    auto evaluate(const Nnue& net) const {
+        return net.evaluate(side[My].data(), side[Op].data());
     }
 
-    // defined in Position.cpp
-    constexpr void moveKing(const Position&, Square from, Square to);
-    constexpr void moveKing(const Position&, Square from, Square to, NonKingType captured);
-    constexpr void castle(const Position&, Square kingFrom, Square kingTo, Square rookFrom, Square rookTo);
+    // defined in Position_impl.hpp
+    void setup(const Nnue&, const Position&);
+    void update(const Nnue&, const DualAcc& parent, const AccUpdate&, const Position&);
 
 private:
-    array<Acc, Side> side{};
+    array<Acc<Neurons>, Side> side{};
     array<Square, Side> mirror{};
 };
 
+// raw evaluation of many positions at once (data processing, not search)
+// accumulators are built slice by slice, each w0 column slice is read once per batch and stays in L1 cache
+class NnueBatch {
+public:
+    static constexpr int Max_size = 16; // batch accumulators of the widest network take 64KB
+
+private:
+    using WRow = Nnue::WRow;
+    using _t = Nnue::_t;
+    static constexpr int Max_features = 32; // all pieces on the board
+
+    const Nnue& net;
+    int size_{0};
+    std::array<int, 2*Max_size> rowCount_; // [position][side]
+    std::array<std::array<WRow, Max_features>, 2*Max_size> rows_;
+    CACHE_ALIGN std::array<_t, 2*Max_size * Nnue::AccIndex::size()> acc_;
+
+public:
+    explicit NnueBatch (const Nnue& _net) : net{_net} {}
+
+    constexpr int size() const { return size_; }
+    constexpr bool isFull() const { return size_ == Max_size; }
+    constexpr void clear() { size_ = 0; }
+
+    // defined in Position.cpp
+    void add(const Position&);
+
+    // raw NNUE evaluations of all added positions in the order they were added
+    void evaluate(int32_t result[]);
+};
+
 #endif
@@ -4,43 +4,6 @@
 #include "Uci.hpp"
 #include "Position_impl.hpp"
 
-// unpractical overengineered transposition table replacement scheme only for experiments
-
-class HashAge {
-public:
-    using _t = int;
-    enum {AgeBits = 3, AgeMask = (1u << AgeBits)-1};
-
-private:
-    _t v_;
-
-public:
-    constexpr HashAge () : v_(1) {}
-    constexpr int operator + () { return v_; }
-
-    void nextAge() {
-        //there are "AgeMask" ages, not "1 << AgeBits", because of:
-        //1) we want to break 4*n ply transposition pattern
-        //2) make sure that initally clear entry is never hidden
-        auto a = (v_ + 1) & AgeMask;
-        v_ = a ? a : 1;
-    }
-
-};
-
-class TtPerft : public Tt {
-public:
-    HashAge hashAge;
-    HashAge getAge() const { return hashAge; }
-    void nextAge() { hashAge.nextAge(); }
-
-    void newGame() { Tt::newGame(); hashAge = {}; }
-    void newIteration() { hashAge.nextAge(); }
-
-    node_count_t get(Z, Ply);
-    void set(Z, Ply, node_count_t);
-};
-
 class CACHE_ALIGN HashBucket {
 public:
     using _t = u64x2_t;
@@ -268,15 +231,20 @@ void TtPerft::set(Z z, Ply d, node_count_t n) {
 
 ReturnStatus NodePerft::visitRoot() {
     NodePerft child{*this};
+    const PiBb rootMoves = moves(); // overwritten by the children in MAKE_UNMAKE mode
 
     int moveCount = 0;
     for (Pi pi : MY.any()) {
         Square from = MY.sq(pi);
 
-        for (Square to : bbMovesOf(pi)) {
+        for (Square to : rootMoves.bb(pi)) {
             auto previousPerft = perft;
 
-            RETURN_IF_STOP (child.visitMove(from, to));
+            if constexpr (MAKE_UNMAKE) {
+                RETURN_IF_STOP (visitInplace(from, to, depth - 1_ply));
+            } else {
+                RETURN_IF_STOP (child.visitMove(from, to));
+            }
 
             The_uci.info_perft_currmove(++moveCount, toMove(from, to), perft - previousPerft);
         }
@@ -286,6 +254,22 @@ ReturnStatus NodePerft::visitRoot() {
     return ReturnStatus::Continue;
 }
 
+node_count_t NodePerft::countRoot() {
+    NodePerft child{*this};
+    const PiBb rootMoves = moves(); // overwritten by the children in MAKE_UNMAKE mode
+
+    for (Pi pi : MY.any()) {
+        Square from = MY.sq(pi);
+
+        for (Square to : rootMoves.bb(pi)) {
+            auto status = MAKE_UNMAKE ? visitInplace(from, to, depth - 1_ply) : child.visitMove(from, to);
+            if (status == ReturnStatus::Stop) { return NodeCountNone; }
+        }
+    }
+
+    return perft;
+}
+
 ReturnStatus NodePerft::visit() {
     NodePerft child{*this};
 
@@ -310,8 +294,7 @@ ReturnStatus NodePerft::visitMove(Square from, Square to) {
             RETURN_IF_STOP (The_uci.limits.countNode());
             makeMovePerft(parent, from, to);
             parent.clearMove(from, to);
-            generateMoves();
-            perft = movesTotal();
+            perft = countMoves();
             break;
 
         default: {
@@ -334,3 +317,45 @@ ReturnStatus NodePerft::visitMove(Square from, Square to) {
     parent.perft += perft;
     return ReturnStatus::Continue;
 }
+
+// make the move inplace, add the perft of the remaining depth and unmake the move
+// (the position is left in the middle of the tree if the search is stopped)
+ReturnStatus NodePerft::visitInplace(Square from, Square to, Ply d) {
+    if (d == 0_ply) {
+        ++perft;
+        return ReturnStatus::Continue;
+    }
+
+    RETURN_IF_STOP (The_uci.limits.countNode());
+    Undo undo;
+    makeMove(undo, from, to);
+    if (d >= 2_ply) { The_transpositionTable.prefetch<64>(z()); }
+
+    if (d == 1_ply) {
+        perft += countMoves();
+    } else {
+        generateMoves();
+
+        auto& tt = static_cast<TtPerft&>(The_transpositionTable);
+        auto n = tt.get(z(), d - 2_ply);
+
+        if (n == NodeCountNone) {
+            auto previousPerft = perft;
+            const PiBb legalMoves = moves(); // overwritten by the next ply
+
+            for (Pi pi : MY.any()) {
+                Square sq = MY.sq(pi);
+
+                for (Square dest : legalMoves.bb(pi)) {
+                    RETURN_IF_STOP (visitInplace(sq, dest, d - 1_ply));
+                }
+            }
+            tt.set(z(), d - 2_ply, perft - previousPerft);
+        } else {
+            perft += n;
+        }
+    }
+
+    unmakeMove(undo);
+    return ReturnStatus::Continue;
+}
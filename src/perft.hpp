@@ -2,9 +2,53 @@
 #define NODE_PERFT_HPP
 
 #include "PositionMoves.hpp"
+#include "Tt.hpp"
 
 class Uci;
 
+// compile-time switch (make MAKE_UNMAKE=1): perft makes and unmakes moves inplace of the single position
+// using undo records instead of copying the parent position into each child node
+#ifndef MAKE_UNMAKE
+#   define MAKE_UNMAKE 0
+#endif
+
+// unpractical overengineered transposition table replacement scheme only for experiments
+
+class HashAge {
+public:
+    using _t = int;
+    enum {AgeBits = 3, AgeMask = (1u << AgeBits)-1};
+
+private:
+    _t v_;
+
+public:
+    constexpr HashAge () : v_(1) {}
+    constexpr int operator + () { return v_; }
+
+    void nextAge() {
+        //there are "AgeMask" ages, not "1 << AgeBits", because of:
+        //1) we want to break 4*n ply transposition pattern
+        //2) make sure that initally clear entry is never hidden
+        auto a = (v_ + 1) & AgeMask;
+        v_ = a ? a : 1;
+    }
+
+};
+
+class TtPerft : public Tt {
+public:
+    HashAge hashAge;
+    HashAge getAge() const { return hashAge; }
+    void nextAge() { hashAge.nextAge(); }
+
+    void newGame() { Tt::newGame(); hashAge = {}; }
+    void newIteration() { hashAge.nextAge(); }
+
+    node_count_t get(Z, Ply);
+    void set(Z, Ply, node_count_t);
+};
+
 class NodePerft : public PositionMoves {
     NodePerft& parent;
     node_count_t perft = 0;
@@ -13,10 +57,14 @@ class NodePerft : public PositionMoves {
     NodePerft (NodePerft& n) : parent{n}, depth{n.depth - 1_ply} {}
     ReturnStatus visit();
     ReturnStatus visitMove(Square from, Square to);
+    ReturnStatus visitInplace(Square from, Square to, Ply d); // MAKE_UNMAKE mode
 
 public:
     NodePerft (const PositionMoves& pos, Ply d) : PositionMoves{pos}, parent(*this), depth{d} {}
     ReturnStatus visitRoot();
+
+    // perft of the root position without per move output (NodeCountNone if stopped)
+    node_count_t countRoot();
 };
 
 #endif
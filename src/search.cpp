@@ -108,11 +108,20 @@ void Node::assertOk() const {
     assert (beta <= Score{MateWin});
 }
 
+template <NodeKind K>
 ReturnStatus Node::negamax(Ply R) {
     child().depth = depth - R; //TRICK: Ply >= 0
     /* assert (child().depth >= 0); */
-    child().generateMoves();
-    RETURN_IF_STOP (child().search());
+    child().generateEvasions(); // other legal moves are generated after the TT probe
+
+    // only a PV node can have a PV child
+    if (isPvKind(K) && child().isPv()) {
+        RETURN_IF_STOP (child().search<PvNode>());
+    } else if (child().depth <= 0_ply && !child().inCheck()) {
+        RETURN_IF_STOP (child().search<QsNode>());
+    } else {
+        RETURN_IF_STOP (child().search<NonPvNode>());
+    }
     assertOk();
 
     auto childScore = -child().score;
@@ -134,7 +143,7 @@ ReturnStatus Node::negamax(Ply R) {
             } else {
                 assert (child().alpha == child().beta.minus1());
             }
-            return negamax();
+            return negamax<K>();
         }
 
         if (beta <= childScore) {
@@ -144,6 +153,15 @@ ReturnStatus Node::negamax(Ply R) {
             if (currentMove.any()) {
                 bestMove = currentMove;
                 saveHistory();
+
+                if constexpr (K == RootNode) {
+                    // aspiration window fail high, report the new best move with the lower bound score
+                    pvIndex = The_uci.pv.set(depth - 1_ply, score, bestMove, child().pvIndex, FailHigh);
+                    child().pvIndex = PrincipalVariation::Index{+pvIndex+1};
+
+                    RETURN_IF_STOP (The_uci.limits.updateTimeStrategy(The_uci.pv));
+                    The_uci.info_pv();
+                }
             }
             return ReturnStatus::Cutoff;
         }
@@ -153,34 +171,36 @@ ReturnStatus Node::negamax(Ply R) {
         assert (isPv()); // alpha < childScore < beta, so current window cannot be zero
         assert (currentMove.any()); // null move in PV is not allowed
 
-        if (!child().isPv()) {
-            child().pvPly = child().ply;
-            assert (child().isPv());
-            child().alpha = -beta;
-            assert (child().beta == -alpha);
-            // Principal Variation Search (PVS) research with full window and full depth
-            return negamax();
-        }
+        if constexpr (isPvKind(K)) {
+            if (!child().isPv()) {
+                child().pvPly = child().ply;
+                assert (child().isPv());
+                child().alpha = -beta;
+                assert (child().beta == -alpha);
+                // Principal Variation Search (PVS) research with full window and full depth
+                return negamax<K>();
+            }
 
-        score = childScore;
-        bound = ExactBound;
-        assert (currentMove.any()); // null move in PV is not allowed
-        bestMove = currentMove;
+            score = childScore;
+            bound = ExactBound;
+            assert (currentMove.any()); // null move in PV is not allowed
+            bestMove = currentMove;
 
-        if (!isRoot()) {
-            child().pvIndex = The_uci.pv.set(pvIndex, bestMove, child().pvIndex);
-        } else {
-            // unfinished iteration, so report depth-1
-            pvIndex = The_uci.pv.set(depth - 1_ply, score, bestMove, child().pvIndex);
-            child().pvIndex = PrincipalVariation::Index{+pvIndex+1};
+            if constexpr (K != RootNode) {
+                child().pvIndex = The_uci.pv.set(pvIndex, bestMove, child().pvIndex);
+            } else {
+                // unfinished iteration, so report depth-1
+                pvIndex = The_uci.pv.set(depth - 1_ply, score, bestMove, child().pvIndex);
+                child().pvIndex = PrincipalVariation::Index{+pvIndex+1};
 
-            RETURN_IF_STOP (The_uci.limits.updateTimeStrategy(The_uci.pv));
+                RETURN_IF_STOP (The_uci.limits.updateTimeStrategy(The_uci.pv));
 
-            if (depth > 1_ply) { The_uci.info_pv(); }
-        }
+                if (depth > 1_ply) { The_uci.info_pv(); }
+            }
 
-        alpha = childScore;
-        child().beta = -alpha;
+            alpha = childScore;
+            child().beta = -alpha;
+        }
     }
 
     // set zero window for the next sibling move search
@@ -191,46 +211,12 @@ ReturnStatus Node::negamax(Ply R) {
     return ReturnStatus::Continue;
 }
 
-namespace {
-
-struct TtRecord {
-    TtEntry ttEntry;
-    TtEntry* tt;
-    bool ttHit;
-};
-
-constexpr TtRecord probe(TtEntry* tt, Z z) {
-    auto ttEntry = TtEntry::read(tt);
-    if (ttEntry == z) { return {ttEntry, tt, true}; }
-
-    auto tt2 = std::bit_cast<TtEntry*>(std::bit_cast<std::uintptr_t>(tt) ^ sizeof(TtEntry));
-    auto ttEntry2 = TtEntry::read(tt2);
-    if (ttEntry2 == z) { return {ttEntry2, tt2, true}; }
-
-    //TRICK: zeroed entry is never fresh
-    bool f1 = The_transpositionTable.isFresh(ttEntry.age());
-    bool f2 = The_transpositionTable.isFresh(ttEntry2.age());
-
-    // preserve fresh
-    if (f1 != f2) {
-        if (f2) {
-            return {ttEntry, tt, false};
-        } else {
-            return {ttEntry2, tt2, false};
-        }
-    }
-
-    // preserve deeper or other
-    if (ttEntry.draft() <= ttEntry2.draft()) {
-        return {ttEntry, tt, false};
-    } else {
-        return {ttEntry2, tt2, false};
-    }
-}
-
-} // end of anonymous namespace
-
+template <NodeKind K>
 ReturnStatus Node::search() {
+    assert (isRoot() == (K == RootNode));
+    assert (isPv() == isPvKind(K));
+    assert (K != QsNode || (depth <= 0_ply && !inCheck()));
+
     baseR = depth / 8;
     eval  = {};
     cEval = {};
@@ -238,9 +224,10 @@ ReturnStatus Node::search() {
     bound = FailLow;
     currentMove = {};
     bestMove = {};
+    quietMovesCount = 0;
     assertOk();
 
-    if (!isRoot()) {
+    if constexpr (K != RootNode) {
         if (inCheck()) {
             if (movesTotal() == 0) {
                 // checkmate
@@ -254,14 +241,6 @@ ReturnStatus Node::search() {
 
             // check extension
             depth = depth + 1_ply;
-        } else {
-            if (movesTotal() == 0) {
-                // stalemate
-                assert (!inCheck());
-                score = Score{DrawScore};
-                assert (currentMove.none());
-                return ReturnStatus::Continue;
-            }
         }
 
         if (isRepetition() || rule50().isDraw() || isDrawMaterial()) {
@@ -293,8 +272,8 @@ ReturnStatus Node::search() {
 
         if (ttEntry.ttMove(z()).any()) [[likely]] {
             auto ttMove = ttEntry.ttMove(z());
-            if (!isPossibleMove(ttMove.from(), ttMove.to())) [[unlikely]] {
-                // collision detection
+            if (!MY.has(ttMove.from()) || !isPseudoLegal(toMove(ttMove))) [[unlikely]] {
+                // collision detection, legal moves may be not generated yet
                 break;
             }
             bestMove = toMove(ttMove);
@@ -310,7 +289,7 @@ ReturnStatus Node::search() {
         ++The_transpositionTable.hits;
 
         Bound ttBound = ttEntry.bound(); assert (ttBound.any());
-        if (!isPv() && depth <= ttEntry.draft() && (ttBound.is(ExactBound)
+        if (!isPvKind(K) && depth <= ttEntry.draft() && (ttBound.is(ExactBound)
             || (ttBound.is(FailHigh) && beta <= ttScore)
             || (ttBound.is(FailLow) && ttScore <= alpha)
         )) {
@@ -341,9 +320,32 @@ ReturnStatus Node::search() {
         }
     } while(false);
 
+    if (K != RootNode && !inCheck()) {
+        // deferred until no TT cutoff, quiescence search needs only captures and queen promotions
+        if (depth <= 0_ply) { generateCaptures(); } else { generateMoves(); }
+
+        if (movesTotal() == 0) {
+            // stalemate
+            score = Score{DrawScore};
+            assert (currentMove.none());
+            return ReturnStatus::Continue;
+        }
+    }
+
+    // quiescence search never tries TT move, while quiet moves were not generated
+    bool isQuiescence = K == QsNode || (K == PvNode && depth <= 0_ply && !inCheck());
+    assert (isQuiescence == (depth <= 0_ply && !inCheck()));
+
+    if (bestMove.any() && !isQuiescence && !isPossibleMove(bestMove)) [[unlikely]] {
+        // collision detection
+        bestMove = {};
+        eval = {};
+        cEval = {};
+    }
+
     if (eval.none() && !inCheck()) { cEval = eval = evaluate(); }
     assert ((inCheck() && eval.none()) || (!inCheck() && eval.isEval()));
-    assert (bestMove.none() || isPossibleMove(bestMove));
+    assert (bestMove.none() || isQuiescence || isPossibleMove(bestMove));
 
     if (ply == MaxPly) {
         // no room to search deeper
@@ -357,14 +359,14 @@ ReturnStatus Node::search() {
     // prepare empty child node to make moves into
     child().clearNode();
 
-    if (depth <= 0_ply && !inCheck()) {
+    if (isQuiescence) {
         assert (depth == 0_ply);
-        return quiescence();
+        return quiescence<K>();
     }
 
     assert (currentMove.none());
 
-    if (!isPv() && !inCheck()) {
+    if (!isPvKind(K) && !inCheck()) {
         if (depth <= 3_ply) {
             auto delta = (depth == 1_ply) ? 50_cp : (depth == 2_ply) ? 150_cp : 200_cp;
             if (Score{MinEval} <= beta && beta <= cEval-delta) {
@@ -376,7 +378,7 @@ ReturnStatus Node::search() {
                 delta = (depth == 1_ply) ? 50_cp : (depth == 2_ply) ? 250_cp : 350_cp;
                 if (cEval+delta < alpha && alpha <= Score{MaxEval}) {
                     // Razoring
-                    return quiescence();
+                    return quiescence<K>();
                 }
             }
         }
@@ -387,48 +389,53 @@ ReturnStatus Node::search() {
             && MY.material().canNullMove() // avoid null move in late endgame
             && Score{MinEval} <= beta && beta <= cEval
         ) {
-            RETURN_CUTOFF (searchNullMove());
+            prefetchChild(bestMove);
+            RETURN_CUTOFF (searchNullMove<K>());
         }
     }
 
     // trying TT move first
     if (bestMove.any()) {
-        RETURN_CUTOFF (searchMove(bestMove));
+        if (!inCheck()) {
+            prefetchChild(killers[0]);
+            prefetchChild(killers[1]);
+        }
+        RETURN_CUTOFF (searchMove<K>(bestMove));
     }
 
-    if (isRoot()) {
+    if constexpr (K == RootNode) {
         for (auto move : The_uci.rootBestMoves) {
             if (move.none()) { break; }
-            RETURN_CUTOFF (searchIfPossible(move));
+            RETURN_CUTOFF (searchIfPossible<K>(move));
         }
     }
 
-    RETURN_CUTOFF (goodCaptures(OP.nonKing()));
+    RETURN_CUTOFF (goodCaptures<K>(OP.nonKing()));
 
     if (inCheck()) {
         if (hasParent()) { //TODO: use game history move when root in check
-            RETURN_CUTOFF (searchIfPossible(
+            RETURN_CUTOFF (searchIfPossible<K>(
                 The_uci.checkMoves.get(colorToMove(), MY.sqKing(), parent().currentMove)
             ));
         }
     } else {
-        RETURN_CUTOFF (searchIfPossible(killers[0]));
+        RETURN_CUTOFF (searchIfPossible<K>(killers[0]));
 
         bool isDeep{ depth > ply };
         if (counterMove().any()) {
-            RETURN_CUTOFF (contMove(isDeep ? DeepCounter : Counter, counterMove())); // ply-1
+            RETURN_CUTOFF (contMove<K>(isDeep ? DeepCounter : Counter, counterMove())); // ply-1
         }
         if (followupMove().any()) {
-            RETURN_CUTOFF (contMove(isDeep ? DeepFollowup : Followup, followupMove())); // ply-2
+            RETURN_CUTOFF (contMove<K>(isDeep ? DeepFollowup : Followup, followupMove())); // ply-2
         }
 
-        RETURN_CUTOFF (searchIfPossible(killers[1]));
+        RETURN_CUTOFF (searchIfPossible<K>(killers[1]));
 
         if (counterMove().any()) {
-            RETURN_CUTOFF (contMove(isDeep ? DeepCounter : Counter, counterMove())); // ply-1
+            RETURN_CUTOFF (contMove<K>(isDeep ? DeepCounter : Counter, counterMove())); // ply-1
         }
         if (followupMove().any()) {
-            RETURN_CUTOFF (contMove(isDeep ? DeepFollowup : Followup, followupMove())); // ply-2
+            RETURN_CUTOFF (contMove<K>(isDeep ? DeepFollowup : Followup, followupMove())); // ply-2
         }
     }
 
@@ -462,7 +469,7 @@ ReturnStatus Node::search() {
                 //TODO: try protecting moves of other pieces
             }
 
-            RETURN_CUTOFF (goodNonCaptures(pi, bbMovesOf(pi) % bbAvoid, 2_ply));
+            RETURN_CUTOFF (goodNonCaptures<K>(PiMask{pi}, bbAvoid, 2_ply));
         }
 
         // safe passed pawns moves
@@ -470,32 +477,27 @@ ReturnStatus Node::search() {
             Pi pi = MY.pi(from);
             for (Square to : bbMovesOf(pi)) {
                 if (MY.bbPawnAttacks().has(to) || !safeForOp(to)) {
-                    RETURN_CUTOFF (searchMove(from, to, from.on(Rank6) ? 1_ply : 2_ply));
+                    RETURN_CUTOFF (searchMove<K>(from, to, from.on(Rank6) ? 1_ply : 2_ply));
                 }
             }
         }
 
         // safe pawns pushes attacking non-pawns
-        RETURN_CUTOFF (goodPawnsMovesTo(~(OP.bbSide() - OP.bbPawns()), 2_ply));
+        RETURN_CUTOFF (goodPawnsMovesTo<K>(~(OP.bbSide() - OP.bbPawns()), 2_ply));
 
         if (depth <= 1_ply && !inCheck() && movesMade() >= 3) { break; }
 
-        if (depth >= 6_ply && movesMade() >= 5) { baseR = baseR + 1_ply; } // LMR
-
         // safe officers moves
-        while (safePieces.any()) {
-            Pi pi = safePieces.piLast(); safePieces -= PiMask{pi};
-            RETURN_CUTOFF (goodNonCaptures(pi, bbMovesOf(pi) % bbAvoid, 3_ply));
-        }
+        RETURN_CUTOFF (goodNonCaptures<K>(safePieces, bbAvoid, 3_ply));
 
-        if (depth <= 2_ply && !inCheck() && (!isPv() || movesMade() > 0)) { break; }
+        if (depth <= 2_ply && !inCheck() && (!isPvKind(K) || movesMade() > 0)) { break; }
 
         // king quiet moves (always safe), castling is a rook move
         {
             Pi pi{TheKing};
             Square from{MY.sqKing()};
             for (Square to : bbMovesOf(pi)) {
-                RETURN_CUTOFF (searchMove(from, to, 3_ply));
+                RETURN_CUTOFF (searchMove<K>(from, to, 3_ply));
             }
         }
 
@@ -503,7 +505,7 @@ ReturnStatus Node::search() {
         for (Pi pi : MY.promotables()) {
             Square from{MY.sq(pi)};
             Square to{from.file(), Rank8};
-            RETURN_CUTOFF (searchIfPossible(toMove(from, to, CanBeKiller::Yes), 3_ply));
+            RETURN_CUTOFF (searchIfPossible<K>(toMove(from, to, CanBeKiller::Yes), 3_ply));
         }
 
         // unsafe (losing) captures (N/B, R, Q order)
@@ -511,7 +513,7 @@ ReturnStatus Node::search() {
             Pi pi = pieces.piLast(); pieces -= PiMask{pi};
             Square from{MY.sq(pi)};
             for (Square to : bbMovesOf(pi) & ~OP.bbSide()) {
-                RETURN_CUTOFF (searchMove(from, to, 3_ply));
+                RETURN_CUTOFF (searchMove<K>(from, to, 3_ply));
             }
         }
 
@@ -520,18 +522,18 @@ ReturnStatus Node::search() {
         for (Square from : MY.bbPawns()) {
             Pi pi = MY.pi(from);
             for (Square to : bbMovesOf(pi)) {
-                RETURN_CUTOFF (searchMove(from, to, 3_ply));
+                RETURN_CUTOFF (searchMove<K>(from, to, 3_ply));
             }
         }
 
-        if (depth <= 4_ply && !inCheck() && (!isPv() || movesMade() > 0)) { break; }
+        if (depth <= 4_ply && !inCheck() && (!isPvKind(K) || movesMade() > 0)) { break; }
 
         // unsafe (losing) non-captures (N/B, R, Q order)
         for (PiMask pieces = MY.officers(); pieces.any(); ) {
             Pi pi = pieces.piLast(); pieces -= PiMask{pi};
             Square from{MY.sq(pi)};
             for (Square to : bbMovesOf(pi)) {
-                RETURN_CUTOFF (searchMove(from, to, 4_ply));
+                RETURN_CUTOFF (searchMove<K>(from, to, 4_ply));
             }
         }
     } while (false);
@@ -549,7 +551,7 @@ ReturnStatus Node::search() {
     if (bound.is(ExactBound)) {
         assert (isPseudoLegal(bestMove));
         saveHistory();
-        if (isRoot()) { ::insert_unique_compact(The_uci.rootBestMoves, bestMove); }
+        if constexpr (K == RootNode) { ::insert_unique_compact(The_uci.rootBestMoves, bestMove); }
     } else {
         assert (bound.is(FailLow));
         assert (bestMove.none() || isPseudoLegal(bestMove));
@@ -561,6 +563,7 @@ ReturnStatus Node::search() {
 }
 
 // safe pawns pushes attacking non-pawns
+template <NodeKind K>
 ReturnStatus Node::goodPawnsMovesTo(Bb target, Ply R) {
     Bb totallySafe = (Bb::full() % bbAttacked()) | (MY.bbPawnAttacks() % ~OP.bbPawnAttacks());
 
@@ -568,7 +571,7 @@ ReturnStatus Node::goodPawnsMovesTo(Bb target, Ply R) {
     for (Square from : MY.bbPawns() & canAttackFrom) {
         Square to{ from.file(), from.rank().forward() }; assert (!OCCUPIED.has(to));
         if ( bbMovesOf(MY.pi(from)).has(to) && (totallySafe.has(to) || !safeForOp(to)) ) {
-            RETURN_CUTOFF (searchMove(from, to, R));
+            RETURN_CUTOFF (searchMove<K>(from, to, R));
         }
     }
 
@@ -578,40 +581,78 @@ ReturnStatus Node::goodPawnsMovesTo(Bb target, Ply R) {
         assert (!OCCUPIED.has(Square{ from.file(), Rank{Rank3} }));
         Square to{ from.file(), Rank{Rank4} }; assert (!OCCUPIED.has(to));
         if ( bbMovesOf(MY.pi(from)).has(to) && (totallySafe.has(to) || !safeForOp(to)) ) {
-            RETURN_CUTOFF (searchMove(from, to, R));
+            RETURN_CUTOFF (searchMove<K>(from, to, R));
         }
     }
 
     return ReturnStatus::Continue;
 }
 
-ReturnStatus Node::goodNonCaptures(Pi pi, Bb bbMoves, Ply R) {
-    PieceType ty = MY.typeOf(pi);
-    assert (!ty.is(Pawn));
-    PiMask opLessValue = OP.lessValue(ty);
-    Square from{MY.sq(pi)};
-    for (Square to : bbMoves) {
-        assert (!OP.bbPawnAttacks().has(~to));
-        assert (isQuietMove(pi, to));
+// quiet moves of the pieces (N/B, R, Q order) to the squares not defended by less valued opponent's pieces,
+// sorted by history, moves with good history are less reduced, moves with bad history are more reduced or pruned
+template <NodeKind K>
+ReturnStatus Node::goodNonCaptures(PiMask pieces, Bb bbAvoid, Ply R) {
+    constexpr int HistoryPruning = -HistoryMoves::Max / 2; // per ply of depth
+
+    std::array<Move, 256> goodMoves;
+    std::array<int, 256> history;
+    int n = 0;
+
+    while (pieces.any()) {
+        Pi pi = pieces.piLast(); pieces -= PiMask{pi};
+        PieceType ty = MY.typeOf(pi);
+        assert (!ty.is(Pawn));
+        PiMask opLessValue = OP.lessValue(ty);
+        Square from{MY.sq(pi)};
 
-        if (bbAttacked().has(to)) {
-            if ((OP.attackersTo(~to) & opLessValue).any()) {
-                // square defended by less valued opponent's piece
-                continue;
+        for (Square to : bbMovesOf(pi) % bbAvoid) {
+            assert (!OP.bbPawnAttacks().has(~to));
+            assert (isQuietMove(pi, to));
+
+            if (bbAttacked().has(to)) {
+                if ((OP.attackersTo(~to) & opLessValue).any()) {
+                    // square defended by less valued opponent's piece
+                    continue;
+                }
+
+                if (!(MY.bbPawnAttacks().has(to) || safeForMe(to))) {
+                    // skip move to the defended square
+                    continue;
+                }
             }
 
-            if (!(MY.bbPawnAttacks().has(to) || safeForMe(to))) {
-                // skip move to the defended square
-                continue;
+            // stable insertion sort by descending history
+            Move move = toMove(from, to, CanBeKiller::Yes);
+            int h = historyOf(move, ty);
+            int i = n++;
+            for (; i > 0 && history[i-1] < h; --i) {
+                goodMoves[i] = goodMoves[i-1];
+                history[i] = history[i-1];
             }
+            goodMoves[i] = move;
+            history[i] = h;
+        }
+    }
+
+    for (int i = 0; i < n; ++i) {
+        if (!isPvKind(K) && !inCheck() && depth <= 3_ply && movesMade() > 0 && history[i] < HistoryPruning * +depth) {
+            // history pruning, the rest of moves have even worse history
+            break;
+        }
+
+        Ply r = R;
+        if (!inCheck()) {
+            // each Max of history: one ply less reduction (at most one), or one ply more (at most two)
+            r = Ply{+R - std::clamp(history[i] / HistoryMoves::Max, -2, 1)};
         }
 
-        RETURN_CUTOFF (searchMove(from, to, R));
+        RETURN_CUTOFF (searchMove<K>(goodMoves[i], r));
     }
 
     return ReturnStatus::Continue;
 }
 
+template <NodeKind K>
 ReturnStatus Node::quiescence() {
     assertOk();
     assert (!inCheck());
@@ -631,9 +672,10 @@ ReturnStatus Node::quiescence() {
     assert (child().beta == -alpha);
 
     // impossible to capture the king, do not even try to save time
-    return goodCaptures(OP.nonKing());
+    return goodCaptures<K>(OP.nonKing());
 }
 
+template <NodeKind K>
 ReturnStatus Node::goodCaptures(PiMask victims) {
     // queen promotion moves, with and without capture
     for (Pi pi : MY.promotables()) {
@@ -642,7 +684,7 @@ ReturnStatus Node::goodCaptures(PiMask victims) {
         for (Square to : queenPromos) {
             if (!safeForOp(to) || OP.bbSide().has(~to)) {
                 // move to safe square or always good promotion with capture
-                RETURN_CUTOFF (searchMove(from, to, 1_ply, CanBeKiller::No));
+                RETURN_CUTOFF (searchMove<K>(from, to, 1_ply, CanBeKiller::No));
             }
         }
     }
@@ -655,30 +697,24 @@ ReturnStatus Node::goodCaptures(PiMask victims) {
         PiMask attackers = canMoveTo(to) % MY.promotables();
         if (attackers.none()) { continue; }
 
-        // simple SEE function, checks only two cases:
-        // 1) victim defended by at least one pawn
-        // 2) attackers does not outnumber defenders (not precise, but effective condition)
-        // then prune captures by more valuable attackers
-        // the rest uncertain captures considered good enough to seek in QS
-        //TODO: check for pinned attackers and defenders
-        //TODO: check if bad capture makes discovered check
-        //TODO: check if defending pawn is pinned and cannot recapture
-        //TODO: try killer heuristics for uncertain and bad captures
-        if (OP.bbPawnAttacks().has(~to) || !safeForMe(to)) {
-            attackers &= MY.lessOrEqualValue(OP.typeOf(victim));
-        }
-
         while (attackers.any()) {
             // LVA (least valuable attacker) order
             Pi pi = attackers.piLast(); attackers -= PiMask{pi};
             Square from{MY.sq(pi)};
-            RETURN_CUTOFF (searchMove(from, to, 1_ply, CanBeKiller::No));
+
+            // losing captures are pruned in QS and searched later with the rest of moves otherwise,
+            // but not the checking ones
+            //TODO: try killer heuristics for uncertain and bad captures
+            if (!seeGe(from, to) && !isCheck(from, to)) { continue; }
+
+            RETURN_CUTOFF (searchMove<K>(from, to, 1_ply, CanBeKiller::No));
         }
     }
 
     return ReturnStatus::Continue;
 }
 
+template <NodeKind K>
 ReturnStatus Node::searchNullMove() {
     RETURN_IF_STOP (The_uci.limits.countNode());
 
@@ -687,7 +723,7 @@ ReturnStatus Node::searchNullMove() {
     child().childNullMove();
 
     Ply R{(beta <= cEval - 400_cp)};
-    return negamax(4_ply + (depth-2_ply)/4 + R);
+    return negamax<K>(4_ply + (depth-2_ply)/4 + R);
 }
 
 void Node::childNullMove() {
@@ -696,6 +732,7 @@ void Node::childNullMove() {
     tt = The_transpositionTable.prefetch<TtEntry>(z());
 }
 
+template <NodeKind K>
 ReturnStatus Node::searchMove(Move move, Ply R) {
     RETURN_IF_STOP (The_uci.limits.countNode());
 
@@ -706,11 +743,17 @@ ReturnStatus Node::searchMove(Move move, Ply R) {
     Square from{move.from()};
     Square to{move.to()};
 
+    if constexpr (K != QsNode) {
+        if (isQuietMove(MY.pi(from), to) && quietMovesCount < static_cast<int>(quietMoves.size())) {
+            quietMoves[quietMovesCount++] = move;
+        }
+    }
+
     currentMove = move;
     clearMove(from, to);
     child().childMove(from, to);
 
-    return negamax(finalR(R));
+    return negamax<K>(finalR(R));
 }
 
 void Node::childMove(Square from, Square to) {
@@ -722,20 +765,29 @@ void Node::childMove(Square from, Square to) {
     The_uci.pv.clear(pvIndex);
 }
 
+void Node::prefetchChild(Move move) const {
+    if (isPossibleMove(move)) {
+        The_transpositionTable.prefetch<TtEntry>(keyAfter(move.from(), move.to()));
+    }
+}
+
 constexpr Ply Node::finalR(Ply R) const {
     if (R <= 1_ply) { return R; }
     if (inCheck()) { return depth >= 6_ply ? 2_ply : 1_ply; } // plus check extension
 
-    return baseR + R;
+    // late move reduction grows with both depth and number of moves already made
+    int lmr = (std::bit_width(static_cast<unsigned>(+depth)) - 1) * (std::bit_width(static_cast<unsigned>(movesMade())) - 1) / 4;
+    return baseR + R + Ply{lmr};
 }
 
 // counter and folloup move heuristic
+template <NodeKind K>
 ReturnStatus Node::contMove(ContIndex::_t ContType, Move move) {
-    for (auto i : range<decltype(The_uci.contMoves)::Index>()) {
+    for (auto i : range<typename decltype(The_uci.contMoves)::Index>()) {
         auto contMove = The_uci.contMoves.get(ContType, i, colorToMove(), move);
         if (contMove.none()) { break; } // insert_unique_compact() garantees no holes
         if (isPossibleMove(contMove)) {
-            return searchMove(contMove);
+            return searchMove<K>(contMove);
         }
     }
     return ReturnStatus::Continue;
@@ -772,6 +824,7 @@ void Node::saveHistory() {
     }
 
     insert_unique_pos(killers, bestMove);
+    updateHistory();
 
     if (!hasParent()) { return; } // ply-1
 
@@ -794,6 +847,64 @@ void Node::saveHistory() {
     }
 }
 
+void Node::updateHistory() {
+    assert (!inCheck());
+    if (!isQuietMove(MY.pi(bestMove.from()), bestMove.to())) { return; }
+
+    int bonus = std::min(+depth * +depth * 16 + +depth * 32, HistoryMoves::Max / 4);
+    auto color = colorToMove();
+    auto counter = hasParent() ? parent().pieceMove() : HistoryMoves::PieceMove{};
+    auto followup = hasGrandParent() ? grandParent().pieceMove() : HistoryMoves::PieceMove{};
+
+    The_uci.historyMoves.update(color, bestMove, MY.typeAt(bestMove.from()), counter, followup, bonus);
+    for (int i = 0; i < quietMovesCount; ++i) {
+        if (quietMoves[i] != bestMove) {
+            Move move = quietMoves[i];
+            The_uci.historyMoves.update(color, move, MY.typeAt(move.from()), counter, followup, -bonus);
+        }
+    }
+}
+
+int Node::historyOf(Move move, PieceType ty) const {
+    auto counter = hasParent() ? parent().pieceMove() : HistoryMoves::PieceMove{};
+    auto followup = hasGrandParent() ? grandParent().pieceMove() : HistoryMoves::PieceMove{};
+    return The_uci.historyMoves.get(colorToMove(), move, ty, counter, followup);
+}
+
+HistoryMoves::PieceMove Node::pieceMove() const {
+    if (currentMove.none()) { return {}; } // null move
+    return {currentMove, MY.typeAt(currentMove.from())}; // the node position is before currentMove
+}
+
+Score Node::evaluate() {
+    constexpr Score SmallEvalMargin = 200_cp;
+
+    if (depth <= 1_ply && smallNnue.isLoaded()) {
+        updateSmallEval();
+        Score smallEval = evaluateSmall();
+
+        // big network evaluation would not change the search result
+        if (smallEval + SmallEvalMargin <= alpha || beta <= smallEval - SmallEvalMargin) {
+            return smallEval;
+        }
+    }
+
+    updateEval();
+    return Position::evaluate();
+}
+
+void Node::updateEval() {
+    if (isEvalReady()) { return; }
+    parent().updateEval(); // root is always evaluated
+    Position::updateEval(parent());
+}
+
+void Node::updateSmallEval() {
+    if (isSmallEvalReady()) { return; }
+    parent().updateSmallEval(); // root is always evaluated
+    Position::updateSmallEval(parent());
+}
+
 constexpr Color Node::colorToMove() const { return The_uci.colorToMove(ply); }
 
 // insufficient mate material
@@ -857,12 +968,49 @@ ReturnStatus Node::searchRoot(const PositionMoves& pos) {
     static_cast<PositionMoves&>(*this) = pos;
     killers = {};
 
-    for (depth = 1_ply; depth.isOk(); ++depth) {
-        tt = The_transpositionTable.prefetch<TtEntry>(z());
-        alpha = Score{MateLoss};
-        beta = Score{MateWin};
+    constexpr Ply AspirationDepth = 5_ply;
+    constexpr Score AspirationDelta = 25_cp;
 
-        RETURN_IF_STOP (search());
+    // window margin is infinite if the score or the margin is outside of evaluation range
+    auto aspirationAlpha = [](Score s, Score delta) {
+        return s.isEval() && Score{MinEval} < s - delta ? s - delta : Score{MateLoss};
+    };
+    auto aspirationBeta = [](Score s, Score delta) {
+        return s.isEval() && s + delta < Score{MaxEval} ? s + delta : Score{MateWin};
+    };
+
+    for (depth = 1_ply; depth.isOk(); ++depth) {
+        // aspiration window around the previous iteration score, widened after each fail high or fail low
+        auto delta = AspirationDelta;
+        auto lastScore = The_uci.pv.score();
+        bool isAspiration = depth >= AspirationDepth && lastScore.any() && lastScore.isEval();
+        Score windowAlpha = isAspiration ? aspirationAlpha(lastScore, delta) : Score{MateLoss};
+        Score windowBeta = isAspiration ? aspirationBeta(lastScore, delta) : Score{MateWin};
+
+        while (true) {
+            tt = The_transpositionTable.prefetch<TtEntry>(z());
+            alpha = windowAlpha;
+            beta = windowBeta;
+
+            RETURN_IF_STOP (search<RootNode>());
+            if (bound.is(ExactBound)) { break; }
+
+            delta = delta + delta;
+            if (bound.is(FailHigh)) {
+                assert (windowBeta != Score{MateWin});
+                windowBeta = aspirationBeta(score, delta);
+            } else {
+                assert (bound.is(FailLow));
+                assert (windowAlpha != Score{MateLoss});
+                windowAlpha = aspirationAlpha(score, delta);
+
+                // the root score has dropped, the PV is not changed
+                The_uci.pv.set(score, FailLow);
+                RETURN_IF_STOP (The_uci.limits.updateTimeStrategy(The_uci.pv));
+                The_uci.info_pv();
+            }
+            setMoves(The_uci.moves()); // refresh moves for research
+        }
         The_uci.pv.set(depth); // iteration fully completed
 
         RETURN_IF_STOP (The_uci.limits.iterationDeadlineReached());
@@ -878,3 +1026,118 @@ ReturnStatus Node::searchRoot(const PositionMoves& pos) {
 
     return ReturnStatus::Continue;
 }
+
+ReturnStatus Node::searchMate(const PositionMoves& pos, int mate) {
+    pvIndex = PrincipalVariation::Index{0};
+
+    // the first proven mate is the shortest one
+    for (int n = 1; n <= mate; ++n) {
+        static_cast<PositionMoves&>(*this) = pos;
+
+        auto status = mateAttack(n);
+        if (status != ReturnStatus::Continue) { return status; }
+    }
+
+    return ReturnStatus::Continue;
+}
+
+ReturnStatus Node::mateAttack(int n) {
+    assert (0 < n);
+    if (!isRoot() && (rule50().isDraw() || isRepetition())) { return ReturnStatus::Continue; }
+    if (!inCheck()) { generateMoves(); } // evasions are already generated
+    child().clearNode();
+
+    std::array<Move, 256> nonChecks; // non-checking moves are tried after all checks
+    int nonChecksCount = 0;
+
+    auto isProven = [&]() {
+        score = -child().score;
+        if (isRoot()) {
+            Ply mateDistance{2*n - 1};
+            assert (score == Score::mateWin(mateDistance)); // mate in n-1 was not found
+            pvIndex = The_uci.pv.set(mateDistance, score, currentMove, child().pvIndex);
+        } else {
+            child().pvIndex = The_uci.pv.set(pvIndex, currentMove, child().pvIndex);
+        }
+        return ReturnStatus::Cutoff;
+    };
+
+    for (Pi pi : MY.any()) {
+        Square from = MY.sq(pi);
+        for (Square to : bbMovesOf(pi)) {
+            RETURN_IF_STOP (The_uci.limits.countNode());
+
+            currentMove = toMove(from, to);
+            child().childMove(from, to);
+            child().generateEvasions();
+
+            if (!child().inCheck()) {
+                if (n > 1) { nonChecks[nonChecksCount++] = currentMove; }
+                continue;
+            }
+
+            if (child().movesTotal() == 0) {
+                // checkmate
+                child().score = Score::mateLoss(child().ply);
+                return isProven();
+            }
+
+            if (n > 1) {
+                auto status = child().mateDefend(n - 1);
+                RETURN_IF_STOP (status);
+                if (status == ReturnStatus::Continue) { return isProven(); }
+            }
+        }
+    }
+
+    for (int i = 0; i < nonChecksCount; ++i) {
+        RETURN_IF_STOP (The_uci.limits.countNode());
+
+        currentMove = nonChecks[i];
+        child().childMove(currentMove.from(), currentMove.to());
+        child().generateEvasions();
+
+        auto status = child().mateDefend(n - 1);
+        RETURN_IF_STOP (status);
+        if (status == ReturnStatus::Continue) { return isProven(); }
+    }
+
+    return ReturnStatus::Continue;
+}
+
+ReturnStatus Node::mateDefend(int n) {
+    assert (0 < n);
+    if (!inCheck()) {
+        generateMoves(); // evasions are already generated
+        if (movesTotal() == 0) { return ReturnStatus::Cutoff; } // stalemate
+    }
+    assert (movesTotal() > 0);
+
+    if (rule50().isDraw() || isRepetition()) { return ReturnStatus::Cutoff; }
+    child().clearNode();
+
+    score = Score::mateLoss(ply); // any defence delays the mate
+    for (Pi pi : MY.any()) {
+        Square from = MY.sq(pi);
+        for (Square to : bbMovesOf(pi)) {
+            RETURN_IF_STOP (The_uci.limits.countNode());
+
+            currentMove = toMove(from, to);
+            child().childMove(from, to);
+            child().generateEvasions();
+
+            auto status = child().mateAttack(n);
+            RETURN_IF_STOP (status);
+            if (status == ReturnStatus::Continue) { return ReturnStatus::Cutoff; } // the defence found
+
+            // the longest mate defence for the PV
+            if (score < -child().score) {
+                score = -child().score;
+                child().pvIndex = The_uci.pv.set(pvIndex, currentMove, child().pvIndex);
+            }
+        }
+    }
+
+    // all moves are mated
+    return ReturnStatus::Continue;
+}
@@ -6,6 +6,10 @@
 
 class TtEntry;
 
+// node kinds of the compile-time specialised search, a node is PV only if its parent has made it PV
+enum NodeKind { RootNode, PvNode, NonPvNode, QsNode };
+constexpr bool isPvKind(NodeKind kind) { return kind == RootNode || kind == PvNode; }
+
 class Node : public PositionMoves {
 protected:
     const Ply ply{0}; // distance from root (root is ply == 0)
@@ -22,39 +26,58 @@ protected:
 
     Move currentMove{}; // last move made from *this into *child
     Move bestMove{}; // TtMove or best move found
-    std::array<Move, 2> killers{}; // Killer heuristic
 
-    PrincipalVariation::Index pvIndex{0}; // start of subPV for the current ply
     TtEntry* tt{nullptr}; // pointer to the TT entry
     ZHash childZHash; // updated from parent or reset caused by currentMove
 
+    // move ordering and PV bookkeeping, read only by full-width nodes
+    std::array<Move, 2> killers{}; // Killer heuristic
+    std::array<Move, 32> quietMoves{}; // quiet moves made in this node, to penalize in history the ones failed before bestMove
+    int quietMovesCount{0};
+    PrincipalVariation::Index pvIndex{0}; // start of subPV for the current ply
+
     void clearNode(); // prepare empty node
     void assertOk() const;
 
-    [[nodiscard]] ReturnStatus negamax(Ply R = 1_ply); // search with child.depth = depth - R, then apply child search score
-    [[nodiscard]] ReturnStatus search();
-    [[nodiscard]] ReturnStatus quiescence();
+    // search functions are specialised by the node kind of *this node, root and PV bookkeeping compile out of NonPv
+    template <NodeKind> [[nodiscard]] ReturnStatus negamax(Ply R = 1_ply); // search with child.depth = depth - R, then apply child search score
+    template <NodeKind> [[nodiscard]] ReturnStatus search();
+    template <NodeKind> [[nodiscard]] ReturnStatus quiescence();
+
+    template <NodeKind> [[nodiscard]] ReturnStatus searchNullMove();
+    template <NodeKind> [[nodiscard]] ReturnStatus searchMove(Move, Ply R = 1_ply);
 
-    [[nodiscard]] ReturnStatus searchNullMove();
-    [[nodiscard]] ReturnStatus searchMove(Move, Ply R = 1_ply);
+    template <NodeKind K>
     [[nodiscard]] ReturnStatus searchMove(Square from, Square to, Ply R, CanBeKiller _canBeKiller = CanBeKiller::Yes) {
-        return searchMove(toMove(from, to, _canBeKiller), R);
+        return searchMove<K>(toMove(from, to, _canBeKiller), R);
     }
 
+    template <NodeKind K>
     [[nodiscard]] ReturnStatus searchIfPossible(Move move, Ply R = 1_ply) {
-        return isPossibleMove(move) ? searchMove(move, R) : ReturnStatus::Continue;
+        return isPossibleMove(move) ? searchMove<K>(move, R) : ReturnStatus::Continue;
     }
 
-    [[nodiscard]] ReturnStatus goodCaptures(PiMask); // winning promotions to queen, winning or equal captures
-    [[nodiscard]] ReturnStatus goodNonCaptures(Pi, Bb, Ply R);
-    [[nodiscard]] ReturnStatus goodPawnsMovesTo(Bb target, Ply R);
+    template <NodeKind> [[nodiscard]] ReturnStatus goodCaptures(PiMask); // winning promotions to queen, winning or equal captures
+    template <NodeKind> [[nodiscard]] ReturnStatus goodNonCaptures(PiMask, Bb bbAvoid, Ply R); // sorted by history
+    template <NodeKind> [[nodiscard]] ReturnStatus goodPawnsMovesTo(Bb target, Ply R);
 
-    [[nodiscard]] ReturnStatus contMove(ContIndex::_t, Move);
+    template <NodeKind> [[nodiscard]] ReturnStatus contMove(ContIndex::_t, Move);
+
+    // `go mate` proof search, NNUE evaluation and TT are not used
+    [[nodiscard]] ReturnStatus mateAttack(int n); // Cutoff if mate in n moves proven, only checks tried as the last move
+    [[nodiscard]] ReturnStatus mateDefend(int n); // Cutoff if some defence avoids mate in n moves
 
     void childNullMove();
     void childMove(Square, Square);
+    void prefetchChild(Move) const; // TT entry of the possible move child, issued while the preceding moves are searched
     void saveHistory();
+    void updateHistory(); // butterfly and continuation history bonus of quiet bestMove and malus of other quiet moves
+    int historyOf(Move, PieceType) const;
     void saveNode(); // write search result into TT
+
+    Score evaluate(); // static evaluation, small network (if loaded) for shallow nodes far outside the window
+    void updateEval(); // lazy accumulators update from the nearest evaluated ancestor
+    void updateSmallEval();
     constexpr Ply finalR(Ply) const;
 
     constexpr bool hasAncestor(Ply n) const { return ply >= n; }
@@ -70,6 +93,7 @@ protected:
 
     constexpr Move counterMove() const;
     constexpr Move followupMove() const;
+    HistoryMoves::PieceMove pieceMove() const; // currentMove and its moving piece type
 
     constexpr bool isRoot() const { return ply == 0_ply; } // ply == 0
     constexpr bool isPv() const { return ply == pvPly; } // ply == pvPly
@@ -90,6 +114,7 @@ public:
     constexpr Node() = default;
     constexpr explicit Node (Ply _ply) : ply{_ply} {}
     ReturnStatus searchRoot(const PositionMoves&);
+    ReturnStatus searchMate(const PositionMoves&, int mate); // Cutoff if mate in `mate` moves or less proven
 };
 
 class Tt;
@@ -0,0 +1,550 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "Bb.hpp"
+#include "Cpu.hpp"
+#include "Hyperbola.hpp"
+#include "perft.hpp"
+#include "PiMask.hpp"
+#include "Score.hpp"
+#include "Tt.hpp"
+#include "Uci.hpp"
+#include "Position_impl.hpp"
+
+#if CPU_X86
+#   include <x86intrin.h>
+#endif
+
+/**
+* Startup constant initialization
+*/
+constexpr const InBetween inBetween;
+constinit const HyperbolaDir hyperbolaDir;
+constinit const HyperbolaSq hyperbolaSq;
+constinit const AttacksFrom attacksFrom;
+constinit const PiOneMask piOneMask;
+constinit const CastlingRules castlingRules;
+constinit const PieceCountTable pieceCountTable;
+
+/* mocks */
+Tt The_transpositionTable{64 * 1024 * 1024}; // the engine default size, most probes miss the CPU caches
+Uci The_uci{std::cout};
+
+void io::error(std::string_view message) { std::cerr << "microbench: " << message << '\n'; }
+
+#ifndef NDEBUG
+void assert_fail(const char* assertion, const char* file, unsigned int line, const char* func) {
+    std::cerr << "Assertion failed: " << func << ": " << assertion << " (" << file << ":" << line << ")\n";
+    std::exit(EXIT_FAILURE); // graceful exit without core dump
+}
+#endif
+
+ostream& io::app_version(ostream& os) { return os << "petrel microbench"; }
+
+// sizeof and cache line breakdown of the search stack node,
+// private Position and PositionMoves fields are reported by their public accessors or as whole blocks
+class NodeLayout : public Node {
+    static constexpr std::size_t CacheLine = 64;
+
+    static std::size_t offsetOf(const Node& node, const auto& f) {
+        return static_cast<std::size_t>(reinterpret_cast<const char*>(&f) - reinterpret_cast<const char*>(&node));
+    }
+
+    static void field(ostream& os, std::string_view name, std::size_t offset, std::size_t size) {
+        os << "  " << std::left << std::setw(22) << name << std::right
+            << std::setw(8) << offset << std::setw(8) << size
+            << std::setw(7) << offset / CacheLine << ".." << (offset + size - 1) / CacheLine << '\n';
+    }
+
+    static void field(ostream& os, const Node& node, std::string_view name, const auto& f) {
+        field(os, name, offsetOf(node, f), sizeof(f));
+    }
+
+public:
+    static void report(ostream& os) {
+        auto node = std::make_unique<NodeLayout>();
+        const NodeLayout& n = *node;
+
+        auto hot = offsetOf(n, n.positionSide(Side{My}));
+
+        os << std::left << std::setw(24) << "field" << std::right << std::setw(8) << "offset" << std::setw(8) << "size" << std::setw(11) << "lines" << '\n';
+        field(os, "Position accumulators", 0, hot);
+        field(os, n, "positionSide(My)", n.positionSide(Side{My}));
+        field(os, n, "positionSide(Op)", n.positionSide(Side{Op}));
+        auto sidesEnd = offsetOf(n, n.positionSide(Side{Op})) + sizeof(PositionSide);
+        field(os, "Position rest", sidesEnd, sizeof(Position) - sidesEnd);
+        field(os, n, "moves()", n.moves());
+        auto movesEnd = offsetOf(n, n.moves()) + sizeof(n.moves());
+        field(os, "PositionMoves rest", movesEnd, offsetOf(n, n.ply) - movesEnd); // Node fields reuse its tail padding
+        field(os, n, "ply", n.ply);
+        field(os, n, "pvPly", n.pvPly);
+        field(os, n, "depth", n.depth);
+        field(os, n, "baseR", n.baseR);
+        field(os, n, "eval", n.eval);
+        field(os, n, "cEval", n.cEval);
+        field(os, n, "score", n.score);
+        field(os, n, "alpha", n.alpha);
+        field(os, n, "beta", n.beta);
+        field(os, n, "bound", n.bound);
+        field(os, n, "currentMove", n.currentMove);
+        field(os, n, "bestMove", n.bestMove);
+        field(os, n, "tt", n.tt);
+        field(os, n, "childZHash", n.childZHash);
+        field(os, n, "killers", n.killers);
+        field(os, n, "quietMoves", n.quietMoves);
+        field(os, n, "quietMovesCount", n.quietMovesCount);
+        field(os, n, "pvIndex", n.pvIndex);
+
+        os << "sizeof PositionSide " << sizeof(PositionSide) << ", Position " << sizeof(Position)
+            << ", PositionMoves " << sizeof(PositionMoves) << ", Node " << sizeof(Node) << " bytes\n";
+        os << "hot part of Node " << sizeof(Node) - hot << " bytes, " << (sizeof(Node) - hot) / CacheLine << " cache lines\n";
+        os << "search stack " << sizeof(Node) * Ply::size() << " bytes\n";
+    }
+};
+
+namespace {
+
+// positions from Uci::bench()
+constexpr io::czstring Fens[] = {
+    "1B1Q2K1/q1p4P/4P3/3Pk1p1/1r1NrR1b/4pn1P/1pRp2n1/1B2N2b w - -",
+    "3R1R2/K3k3/1p1nPb2/pN2P2N/nP1ppp2/4P3/6P1/4Qq1r w - -",
+    "8/1Pp5/nP5K/p7/8/8/PR6/2r4k w - -",
+    "1k2b3/4bpp1/p2pp1P1/1p3P2/2q1P3/4B3/PPPQN2r/1K1R4 w - -",
+    "2b3r1/6pp/1kn2p2/7N/ppp1PN2/5P2/1PP2KPP/R7 b - - 1 28",
+    "2kr3r/Qbp1q1bp/1np3p1/5p2/2P1pP2/1PN3P1/PBK3BP/3RR3 w - - 0 21",
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+};
+
+constexpr int Repeats = 7; // the best of repeated runs filters out interrupts and frequency ramp-up
+constexpr double RegressionThreshold = 5.0; // percents slower than baseline to be reported
+
+// exposes protected Position internals to the benchmarks
+class BenchPosition : public PositionMoves {
+public:
+    explicit BenchPosition (const PositionMoves& pos) : PositionMoves{pos} {}
+
+    void moveFast(const BenchPosition& parent, Square from, Square to) { makeMovePerft(parent, from, to); }
+    void moveZobrist(const BenchPosition& parent, Square from, Square to) { makeMovePerft(parent, from, to, [](Z){}); }
+    void moveFull(const BenchPosition& parent, Square from, Square to) { makeMove(parent, from, to, ZHash{}, [](Z){}); }
+    void computeEval(const BenchPosition& parent) { updateEval(parent); }
+
+    PositionSide& side(Side si) { return positionSide(si); }
+    Bb bbOccupied(Side si) const { return occupied(si); }
+
+    void forEachMove(auto&& visit) const {
+        for (Pi pi : MY.any()) {
+            Square from = MY.sq(pi);
+
+            for (Square to : bbMovesOf(pi)) {
+                visit(from, to);
+            }
+        }
+    }
+};
+
+struct BenchMove {
+    int parent; // index in the positions vector
+    Square from;
+    Square to;
+};
+
+struct Result {
+    std::string name;
+    long ops; // operations in one pass
+    int passes;
+    double ticks; // per operation, the best of Repeats runs
+};
+
+std::vector<Result> results;
+
+// prevent the compiler from optimizing away the benchmarked computation
+template <typename T>
+void keep(const T& v) { asm volatile ("" : : "m"(v) : "memory"); }
+
+// serialized time stamp counter, nanoseconds on non x86 hosts
+u64_t ticks() {
+#if CPU_X86
+    _mm_lfence();
+    u64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    return static_cast<u64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+constexpr io::czstring TicksUnit = CPU_X86 ? "tsc" : "ns";
+
+// run fixed number of passes of the body doing `ops` operations each
+void bench(std::string_view name, long ops, int passes, auto&& body) {
+    double best = std::numeric_limits<double>::max();
+
+    body(); // warm up caches and branch predictors
+    for (int r = 0; r < Repeats; ++r) {
+        auto start = ticks();
+        for (int p = 0; p < passes; ++p) { body(); }
+        auto elapsed = ticks() - start;
+
+        best = std::min(best, static_cast<double>(elapsed) / static_cast<double>(ops * passes));
+    }
+
+    results.push_back({std::string{name}, ops, passes, best});
+}
+
+// read baseline results of the previously saved JSON output (one result per line)
+std::map<std::string, double> readBaseline(const std::string& fileName) {
+    std::map<std::string, double> baseline;
+
+    std::ifstream file{fileName};
+    if (!file) {
+        std::cerr << "microbench: no baseline file: " << fileName << '\n';
+        return baseline;
+    }
+
+    static constexpr std::string_view NameKey = "\"name\": \"";
+    static constexpr std::string_view TicksKey = "\"ticks\": ";
+
+    for (std::string line; std::getline(file, line); ) {
+        auto n = line.find(NameKey);
+        auto t = line.find(TicksKey);
+        if (n == std::string::npos || t == std::string::npos) { continue; }
+
+        n += NameKey.size();
+        auto name = line.substr(n, line.find('"', n) - n);
+        baseline[name] = std::strtod(line.c_str() + t + TicksKey.size(), nullptr);
+    }
+    return baseline;
+}
+
+void writeJson(ostream& os) {
+    os << "{\n";
+    os << "  \"version\": \"" << io::app_version << "\",\n";
+    os << "  \"isa\": \"" << Cpu::isa() << "\",\n";
+    os << "  \"sliders\": \"" << Cpu::sliders() << "\",\n";
+    os << "  \"unit\": \"" << TicksUnit << "\",\n";
+    os << "  \"results\": [\n";
+    for (const auto& r : results) {
+        os << "    {\"name\": \"" << r.name << "\", \"ops\": " << r.ops << ", \"passes\": " << r.passes
+            << ", \"ticks\": " << std::fixed << std::setprecision(2) << r.ticks << "}"
+            << (&r != &results.back() ? ",\n" : "\n");
+    }
+    os << "  ]\n";
+    os << "}\n";
+}
+
+void writeTable(ostream& os, const std::map<std::string, double>& baseline) {
+    os << std::left << std::setw(24) << "kernel" << std::right << std::setw(12) << TicksUnit << "/op";
+    if (!baseline.empty()) { os << std::setw(12) << "baseline" << std::setw(10) << "delta"; }
+    os << '\n';
+
+    int regressions = 0;
+    for (const auto& r : results) {
+        os << std::left << std::setw(24) << r.name << std::right << std::setw(15) << std::fixed << std::setprecision(2) << r.ticks;
+
+        auto it = baseline.find(r.name);
+        if (it != baseline.end() && it->second > 0) {
+            auto delta = (r.ticks / it->second - 1.0) * 100.0;
+            os << std::setw(12) << it->second << std::setw(9) << std::showpos << delta << std::noshowpos << '%';
+            if (delta > RegressionThreshold) {
+                os << "  slower";
+                ++regressions;
+            }
+        }
+        os << '\n';
+    }
+
+    if (!baseline.empty()) {
+        os << regressions << " kernels slower than baseline by more than " << std::defaultfloat << RegressionThreshold << "%\n";
+    }
+}
+
+} // end of anonymous namespace
+
+int main(int argc, const char* argv[]) {
+    std::string jsonFile;
+    std::string baselineFile;
+
+    Cpu::select(Cpu::supported());
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+
+        if (arg == "--isa" && i+1 < argc) {
+            if (!Cpu::select(argv[++i])) {
+                std::cerr << "microbench: unsupported instruction set: " << argv[i] << ", supported up to " << Cpu::supported() << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--sliders" && i+1 < argc) {
+            if (!Cpu::selectSliders(argv[++i])) {
+                std::cerr << "microbench: unsupported sliding attacks backend: " << argv[i] << ", instruction set " << Cpu::isa() << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--json" && i+1 < argc) {
+            jsonFile = argv[++i];
+        }
+        else if (arg == "--baseline" && i+1 < argc) {
+            baselineFile = argv[++i];
+        }
+        else if (arg == "--layout") {
+            NodeLayout::report(std::cout);
+            return EXIT_SUCCESS;
+        }
+        else {
+            std::cerr << "Usage: microbench [--isa NAME] [--sliders NAME] [--json FILE] [--baseline FILE] [--layout]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // root positions and all their children with computed evaluation accumulators
+    std::vector<BenchPosition> positions;
+    for (auto fen : Fens) {
+        UciPosition root;
+        std::istringstream is{fen};
+        root.readFen(is);
+        if (is.fail()) {
+            std::cerr << "microbench: invalid FEN: " << fen << '\n';
+            return EXIT_FAILURE;
+        }
+        positions.emplace_back(root);
+    }
+
+    std::vector<BenchPosition> children;
+    for (const auto& root : positions) {
+        root.forEachMove([&](Square from, Square to) {
+            BenchPosition child{root};
+            child.moveFull(root, from, to);
+            child.computeEval(root);
+            child.generateMoves();
+            children.push_back(child);
+        });
+    }
+    positions.insert(positions.end(), children.begin(), children.end());
+
+    std::vector<BenchMove> moves;
+    for (int i = 0; i < static_cast<int>(positions.size()); ++i) {
+        positions[i].forEachMove([&](Square from, Square to) { moves.push_back({i, from, to}); });
+    }
+
+    // hash keys of the grandchildren positions, too many to fit in CPU caches
+    std::vector<Z> keys;
+    {
+        BenchPosition child{positions[0]};
+        BenchPosition grandchild{positions[0]};
+        for (const auto& m : moves) {
+            child.moveZobrist(positions[m.parent], m.from, m.to);
+            child.generateMoves();
+            child.forEachMove([&](Square from, Square to) {
+                grandchild.moveZobrist(child, from, to);
+                keys.push_back(grandchild.z());
+            });
+        }
+    }
+
+    const long nPositions = static_cast<long>(positions.size());
+    const long nMoves = static_cast<long>(moves.size());
+    const long nKeys = static_cast<long>(keys.size());
+
+    BenchPosition child{positions[0]};
+
+    bench("makeMove.fast", nMoves, 20, [&] {
+        for (const auto& m : moves) {
+            child.moveFast(positions[m.parent], m.from, m.to);
+            keep(child);
+        }
+    });
+
+    bench("makeMove.zobrist", nMoves, 20, [&] {
+        for (const auto& m : moves) {
+            child.moveZobrist(positions[m.parent], m.from, m.to);
+            keep(child);
+        }
+    });
+
+    bench("makeMove.full", nMoves, 20, [&] {
+        for (const auto& m : moves) {
+            child.moveFull(positions[m.parent], m.from, m.to);
+            keep(child);
+        }
+    });
+
+    bench("makeMove.inplace", nMoves, 5, [&] {
+        for (const auto& m : moves) {
+            child = positions[m.parent];
+            child.makeMove(m.from, m.to);
+            keep(child);
+        }
+    });
+
+    bench("generateCaptures", nPositions, 200, [&] {
+        for (auto& pos : positions) {
+            pos.generateCaptures();
+            keep(pos);
+        }
+    });
+
+    bench("generateMoves", nPositions, 200, [&] {
+        for (auto& pos : positions) {
+            pos.generateMoves();
+            keep(pos);
+        }
+    });
+
+    bench("countMoves", nPositions, 200, [&] {
+        for (auto& pos : positions) {
+            keep(pos.countMoves());
+        }
+    });
+
+    bench("piMask", nPositions * Square::size(), 200, [&] {
+        for (const auto& pos : positions) {
+            for (auto sq : range<Square>()) {
+                auto piMask = pos.moves().piMask(sq);
+                keep(piMask);
+            }
+        }
+    });
+
+    bench("updateSliders", nPositions * Side::size(), 200, [&] {
+        for (auto& pos : positions) {
+            for (auto si : range<Side>()) {
+                pos.side(si).updateSliders(pos.side(si).sliders(), pos.bbOccupied(si));
+            }
+            keep(pos);
+        }
+    });
+
+    bench("updateSliders.one", nPositions * Side::size(), 200, [&] {
+        for (auto& pos : positions) {
+            for (auto si : range<Side>()) {
+                auto sliders = pos.side(si).sliders();
+                if (sliders.any()) {
+                    pos.side(si).updateSliders(PiMask{sliders.piFirst()}, pos.bbOccupied(si));
+                }
+            }
+            keep(pos);
+        }
+    });
+
+    bench("countAttackersTo", nPositions * Square::size(), 50, [&] {
+        for (const auto& pos : positions) {
+            for (auto sq : range<Square>()) {
+                int n = pos.positionSide(My).countAttackersTo(sq, pos.bbOccupied(My));
+                keep(n);
+            }
+        }
+    });
+
+    bench("countAttackers", nPositions, 50, [&] {
+        for (const auto& pos : positions) {
+            SquareCount my = pos.positionSide(My).countAttackers(pos.bbOccupied(My));
+            SquareCount op = ~pos.positionSide(Op).countAttackers(pos.bbOccupied(Op));
+            keep(my.greater(op).v());
+        }
+    });
+
+    {
+        using Acc = ::Acc<Nnue::Max_neurons>;
+        static Acc acc[2];
+        acc[0].setup<My>(nnue, positions[0], Square{static_cast<Square::_t>(0)});
+
+        // ping-pong between two accumulators, each update depends on the previous one
+        bench("Acc::move", nMoves, 20, [&] {
+            int i = 0;
+            for (const auto& m : moves) {
+                acc[(i+1) & 1].move(nnue, acc[i & 1], Square{static_cast<Square::_t>(0)}, My, Knight, m.from, m.to);
+                ++i;
+            }
+            keep(acc);
+        });
+
+        bench("Acc::capture", nMoves, 20, [&] {
+            int i = 0;
+            for (const auto& m : moves) {
+                acc[(i+1) & 1].move(nnue, acc[i & 1], Square{static_cast<Square::_t>(0)}, My, Knight, m.from, m.to, NonKingType{Pawn});
+                ++i;
+            }
+            keep(acc);
+        });
+
+        bench("Acc::setup", nPositions, 20, [&] {
+            for (const auto& pos : positions) {
+                acc[0].setup<My>(nnue, pos, nnue.mirrorMask(pos.positionSide(My).sqKing()));
+                keep(acc[0]);
+            }
+        });
+
+        std::vector<std::array<Acc, Side::size()>> accs(positions.size());
+        for (int i = 0; i < nPositions; ++i) {
+            const auto& pos = positions[i];
+            accs[i][My].setup<My>(nnue, pos, nnue.mirrorMask(pos.positionSide(My).sqKing()));
+            accs[i][Op].setup<Op>(nnue, pos, nnue.mirrorMask(pos.positionSide(Op).sqKing()));
+        }
+
+        bench("Nnue::evaluate", nPositions, 20, [&] {
+            for (const auto& acc : accs) {
+                auto eval = nnue.evaluate(acc[My].data(), acc[Op].data());
+                keep(eval);
+            }
+        });
+    }
+
+    bench("probe", nKeys, 3, [&] {
+        for (auto z : keys) {
+            auto record = ::probe(The_transpositionTable.addr<TtEntry>(z), z);
+            keep(record);
+        }
+    });
+
+    bench("probe.prefetched", nKeys, 3, [&] {
+        constexpr int Ahead = 8;
+        for (long i = 0; i < nKeys; ++i) {
+            if (i + Ahead < nKeys) { The_transpositionTable.prefetch<TtEntry>(keys[i + Ahead]); }
+            auto record = ::probe(The_transpositionTable.addr<TtEntry>(keys[i]), keys[i]);
+            keep(record);
+        }
+    });
+
+    auto& ttPerft = static_cast<TtPerft&>(The_transpositionTable);
+
+    bench("TtPerft::set", nKeys, 3, [&] {
+        for (auto z : keys) {
+            ttPerft.set(z, 2_ply, 1000);
+        }
+    });
+
+    bench("TtPerft::get", nKeys, 3, [&] {
+        for (auto z : keys) {
+            auto n = ttPerft.get(z, 2_ply);
+            keep(n);
+        }
+    });
+
+    std::cout << io::app_version << ' ' << Cpu::isa() << ' ' << Cpu::sliders() << ", "
+        << nPositions << " positions, " << nMoves << " moves, " << nKeys << " keys\n";
+
+    std::map<std::string, double> baseline;
+    if (!baselineFile.empty()) { baseline = readBaseline(baselineFile); }
+    writeTable(std::cout, baseline);
+
+    if (!jsonFile.empty()) {
+        std::ofstream file{jsonFile};
+        writeJson(file);
+        if (!file) {
+            std::cerr << "microbench: failed to write " << jsonFile << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
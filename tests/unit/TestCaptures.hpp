@@ -0,0 +1,88 @@
+#include "PositionMoves.hpp"
+#include "Uci.hpp"
+
+class CapturesPosition : public PositionMoves {
+public:
+    explicit CapturesPosition(const PositionMoves& pos) : PositionMoves{pos} {}
+    void makeMove(const CapturesPosition& parent, Square from, Square to) { makeMovePerft(parent, from, to); }
+};
+
+// subset of full legal moves expected from generateCaptures()
+Bb expectedCaptures(const PositionMoves& full, Pi pi) {
+    Bb bb = full.bbMovesOf(pi);
+    if (pi == Pi{TheKing}) { return bb; }
+    if (full.MY.isPromotable(pi)) { return bb & Bb{Rank8}; } // queen promotions
+    return bb & ~full.OP.bbSide();
+}
+
+// compare generateCaptures() against filtered generateMoves() in every node of perft tree
+void assertCaptures(const CapturesPosition& pos, int depth, const char* fen, long& nodes) {
+    CapturesPosition fullMoves{pos};
+    fullMoves.generateMoves();
+    const CapturesPosition& full = fullMoves;
+
+    CapturesPosition capturesMoves{pos};
+    capturesMoves.generateCaptures();
+    const CapturesPosition& captures = capturesMoves;
+    ++nodes;
+
+    if (full.inCheck() || full.movesTotal() == 0) {
+        // all legal moves expected
+        assert (captures.movesTotal() == full.movesTotal() && "check evasions or stalemate mismatch");
+        for (Pi pi : full.MY.any()) {
+            assert (captures.bbMovesOf(pi) == full.bbMovesOf(pi) && "check evasions or stalemate mismatch");
+        }
+    } else {
+        int total = 0;
+        for (Pi pi : full.MY.any()) {
+            total += expectedCaptures(full, pi).popcount();
+        }
+        bool isFallback = total == 0; // no captures, no king moves: all moves generated
+
+        for (Pi pi : full.MY.any()) {
+            Bb expected = isFallback ? full.bbMovesOf(pi) : expectedCaptures(full, pi);
+            if (captures.bbMovesOf(pi) != expected) {
+                std::cerr << "FAIL: captures mismatch of " << full.MY.sq(pi) << " [FEN: " << fen << "]\n";
+                assert (false);
+            }
+        }
+        assert (captures.movesTotal() == (isFallback ? full.movesTotal() : total));
+    }
+
+    if (depth == 0) { return; }
+
+    CapturesPosition child{pos};
+    for (Pi pi : full.MY.any()) {
+        Square from = full.MY.sq(pi);
+        for (Square to : full.bbMovesOf(pi)) {
+            child.makeMove(full, from, to);
+            assertCaptures(child, depth-1, fen, nodes);
+        }
+    }
+}
+
+void assertCapturesTree(const char* fen, int depth) {
+    UciPosition uciPosition;
+    std::istringstream is{fen};
+    uciPosition.readFen(is);
+
+    long nodes = 0;
+    assertCaptures(CapturesPosition{uciPosition}, depth, fen, nodes);
+    assert (nodes > 0);
+}
+
+void test_captures_perft() {
+    assertCapturesTree("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 3);
+    assertCapturesTree("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 2);
+    assertCapturesTree("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 4); // en passant and pins
+    assertCapturesTree("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 2); // promotions
+    assertCapturesTree("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 2);
+    assertCapturesTree("k7/8/1Q6/8/8/8/8/7K b - - 0 1", 0); // stalemate
+    assertCapturesTree("7k/5Q2/8/8/p7/8/8/7K b - - 0 1", 1); // no captures, no king moves, but pawn push
+}
+
+namespace TestCaptures {
+    void test() {
+        test_captures_perft();
+    }
+}
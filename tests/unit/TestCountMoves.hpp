@@ -0,0 +1,58 @@
+#include "PositionMoves.hpp"
+#include "Uci.hpp"
+
+class CountPosition : public PositionMoves {
+public:
+    explicit CountPosition(const PositionMoves& pos) : PositionMoves{pos} {}
+    void makeMove(const CountPosition& parent, Square from, Square to) { makeMovePerft(parent, from, to); }
+};
+
+// compare countMoves() against generateMoves() in every node of perft tree
+void assertCountMoves(const CountPosition& pos, int depth, const char* fen, long& nodes) {
+    CountPosition counted{pos};
+    MovesNumber n = counted.countMoves();
+
+    CountPosition parentMoves{pos};
+    parentMoves.generateMoves();
+    const CountPosition& parent = parentMoves;
+    ++nodes;
+
+    if (n != parent.movesTotal() || counted.movesTotal() != n) {
+        std::cerr << "FAIL: countMoves " << n << " != " << parent.movesTotal() << " [FEN: " << fen << "]\n";
+        assert (false);
+    }
+    if (depth == 0) { return; }
+
+    CountPosition child{parent};
+    for (Pi pi : parent.MY.any()) {
+        Square from = parent.MY.sq(pi);
+        for (Square to : parent.bbMovesOf(pi)) {
+            child.makeMove(parent, from, to);
+            assertCountMoves(child, depth-1, fen, nodes);
+        }
+    }
+}
+
+void assertCountMovesTree(const char* fen, int depth) {
+    UciPosition uciPosition;
+    std::istringstream is{fen};
+    uciPosition.readFen(is);
+
+    long nodes = 0;
+    assertCountMoves(CountPosition{uciPosition}, depth, fen, nodes);
+    assert (nodes > 0);
+}
+
+void test_count_moves_perft() {
+    assertCountMovesTree("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 3);
+    assertCountMovesTree("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 2); // castlings
+    assertCountMovesTree("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 4); // en passant and pins
+    assertCountMovesTree("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 2); // promotions
+    assertCountMovesTree("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 2);
+}
+
+namespace TestCountMoves {
+    void test() {
+        test_count_moves_perft();
+    }
+}
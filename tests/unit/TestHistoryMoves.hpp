@@ -90,6 +90,66 @@ void test_history_moves() {
     hm.set(DeepFollowup, color, move1, move3);
     assert(hm.get(DeepFollowup, ContMoves<2>::Index{0}, color, move1) == move3);
     assert(hm.get(DeepFollowup, ContMoves<2>::Index{1}, color, move1) == move2);
+
+    // previous move slot is keyed by move type and destination square, origin square is ignored
+    Square otherFrom{ move1.from() == Square{A1} ? B1 : A1 };
+    Move sameSlot{TtMove{otherFrom, move1.to(), CanBeKiller::Yes}, move1.moveType()};
+    assert(hm.get(DeepFollowup, ContMoves<2>::Index{0}, color, sameSlot) == move3);
+
+    // other continuation types and colors are independent
+    assert(hm.get(Followup, ContMoves<2>::Index{0}, color, move1).none());
+    assert(hm.get(DeepFollowup, ContMoves<2>::Index{0}, ~color, move1).none());
+}
+
+// -----------------------------------------------------------------------------
+// ✅ Test: HistoryMoves gravity and saturation at +-Max
+// -----------------------------------------------------------------------------
+void test_history_gravity() {
+    constexpr int Max = HistoryMoves::Max;
+    static HistoryMoves hm; // too big for the stack
+    hm = {};
+
+    Color color{White};
+    Move move{TtMove{Square{B1}, Square{C3}, CanBeKiller::Yes}, MoveType{MoveQN}};
+    HistoryMoves::PieceMove none{};
+    HistoryMoves::PieceMove counter{randomMove(), Bishop};
+    HistoryMoves::PieceMove followup{randomMove(), Pawn};
+
+    assert(hm.get(color, move, Knight, none, none) == 0);
+
+    // gravity: the second equal bonus adds less than the first one
+    hm.update(color, move, Knight, none, none, Max/4);
+    assert(hm.get(color, move, Knight, none, none) == Max/4);
+    hm.update(color, move, Knight, none, none, Max/4);
+    assert(hm.get(color, move, Knight, none, none) == Max/4 + Max/4 - (Max/4) * (Max/4) / Max);
+
+    // saturation: repeated bonus converges to Max and never overshoots
+    for (int i = 0; i < 100; ++i) {
+        hm.update(color, move, Knight, counter, followup, Max/4);
+        assert(hm.get(color, move, Knight, counter, followup) <= 3*Max);
+    }
+    assert(hm.get(color, move, Knight, counter, followup) == 3*Max);
+
+    // the full bonus jumps to the limit at once
+    hm.update(color, move, Knight, counter, followup, -Max);
+    assert(hm.get(color, move, Knight, counter, followup) == -3*Max);
+
+    for (int i = 0; i < 100; ++i) {
+        hm.update(color, move, Knight, counter, followup, -Max/4);
+        assert(hm.get(color, move, Knight, counter, followup) >= -3*Max);
+    }
+    assert(hm.get(color, move, Knight, counter, followup) == -3*Max);
+
+    // continuation is keyed by the previous move piece type
+    assert(hm.get(color, move, Knight, {counter.move, Rook}, none) == -Max);
+
+    // continuation tables are shared by both colors, butterfly is not
+    assert(hm.get(~color, move, Knight, counter, followup) == -2*Max);
+
+    // only officers moves are kept in the continuation tables
+    Move pawnMove{TtMove{Square{E2}, Square{E4}, CanBeKiller::Yes}, MoveType{MoveSpecial}};
+    hm.update(color, pawnMove, Pawn, counter, followup, -Max);
+    assert(hm.get(color, pawnMove, Pawn, counter, followup) == -Max);
 }
 
 // -----------------------------------------------------------------------------
@@ -298,6 +358,7 @@ void test_insert_unique_pos() {
 namespace TestHistoryMoves {
     void test() {
         test_history_moves();
+        test_history_gravity();
         test_insert_unique_compact();
         test_insert_unique_pos();
     }
@@ -0,0 +1,57 @@
+#include "PositionMoves.hpp"
+#include "Uci.hpp"
+
+class KeyPosition : public PositionMoves {
+public:
+    explicit KeyPosition(const PositionMoves& pos) : PositionMoves{pos} {}
+
+    // child zobrist key calculated from scratch
+    void makeMove(const KeyPosition& parent, Square from, Square to) { makeMovePerft(parent, from, to); setZobrist(); }
+};
+
+// compare keyAfter() of the parent against generated zobrist key of the child in every node of perft tree
+void assertKeyAfter(const KeyPosition& pos, int depth, const char* fen, long& nodes) {
+    KeyPosition parentMoves{pos};
+    parentMoves.generateMoves();
+    const KeyPosition& parent = parentMoves;
+    ++nodes;
+    if (depth == 0) { return; }
+
+    KeyPosition child{parent};
+    for (Pi pi : parent.MY.any()) {
+        Square from = parent.MY.sq(pi);
+        for (Square to : parent.bbMovesOf(pi)) {
+            child.makeMove(parent, from, to);
+            if (parent.keyAfter(from, to) != child.z()) {
+                std::cerr << "FAIL: keyAfter mismatch of " << from << to << " [FEN: " << fen << "]\n";
+                assert (false);
+            }
+            assertKeyAfter(child, depth-1, fen, nodes);
+        }
+    }
+}
+
+void assertKeyAfterTree(const char* fen, int depth) {
+    UciPosition uciPosition;
+    std::istringstream is{fen};
+    uciPosition.readFen(is);
+
+    long nodes = 0;
+    assertKeyAfter(KeyPosition{uciPosition}, depth, fen, nodes);
+    assert (nodes > 0);
+}
+
+void test_key_after_perft() {
+    assertKeyAfterTree("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 3);
+    assertKeyAfterTree("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 2); // castlings
+    assertKeyAfterTree("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 4); // en passant and pins
+    assertKeyAfterTree("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 2); // promotions
+    assertKeyAfterTree("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 2);
+    assertKeyAfterTree("4k3/8/8/8/1p6/8/P1P5/4K2R w K - 0 1", 3); // double pushes next to enemy pawn
+}
+
+namespace TestKeyAfter {
+    void test() {
+        test_key_after_perft();
+    }
+}
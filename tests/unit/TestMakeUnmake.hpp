@@ -0,0 +1,91 @@
+#include "PositionMoves.hpp"
+#include "Uci.hpp"
+#include "Position_impl.hpp"
+
+class UnmakePosition : public PositionMoves {
+public:
+    using Position::Undo;
+
+    explicit UnmakePosition(const PositionMoves& pos) : PositionMoves{pos} {}
+    void makeMove(const UnmakePosition& parent, Square from, Square to) { makeMovePerft(parent, from, to, [](Z){}); }
+    void makeMove(Undo& undo, Square from, Square to) { Position::makeMove(undo, from, to); }
+    void unmakeMove(const Undo& undo) { Position::unmakeMove(undo); }
+};
+
+bool isSameSide(const PositionSide& a, const PositionSide& b) {
+    if (a.bbSide() != b.bbSide() || a.bbPawns() != b.bbPawns()) { return false; }
+    if (!(a.any() == b.any()) || !(a.sliders() == b.sliders()) || !(a.pawns() == b.pawns())) { return false; }
+    if (!(a.castlingRooks() == b.castlingRooks()) || !(a.enPassantPawns() == b.enPassantPawns())) { return false; }
+    if (!(a.pinners() == b.pinners()) || !(a.promotables() == b.promotables())) { return false; }
+
+    for (Pi pi : range<Pi>()) {
+        if (a.attacks().bb(pi) != b.attacks().bb(pi)) { return false; }
+    }
+    for (Pi pi : a.any()) {
+        if (a.sq(pi) != b.sq(pi) || a.typeOf(pi) != b.typeOf(pi)) { return false; }
+    }
+    return true;
+}
+
+bool isSamePosition(const PositionMoves& a, const PositionMoves& b) {
+    return a.z() == b.z()
+        && isSameSide(a.positionSide(My), b.positionSide(My))
+        && isSameSide(a.positionSide(Op), b.positionSide(Op));
+}
+
+// inplace make/unmake against copy-make in every node of perft tree
+void assertMakeUnmake(UnmakePosition& pos, int depth, const char* fen, long& nodes) {
+    pos.generateMoves();
+    ++nodes;
+    if (depth == 0) { return; }
+
+    const UnmakePosition parent{pos};
+    UnmakePosition child{parent};
+
+    for (Pi pi : parent.MY.any()) {
+        Square from = parent.MY.sq(pi);
+        for (Square to : parent.bbMovesOf(pi)) {
+            child.makeMove(parent, from, to);
+
+            UnmakePosition::Undo undo;
+            pos.makeMove(undo, from, to);
+            if (!isSamePosition(pos, child)) {
+                std::cerr << "FAIL: make mismatch of " << from << to << " [FEN: " << fen << "]\n";
+                assert (false);
+            }
+
+            assertMakeUnmake(pos, depth-1, fen, nodes);
+
+            pos.unmakeMove(undo);
+            if (!isSamePosition(pos, parent)) {
+                std::cerr << "FAIL: unmake mismatch of " << from << to << " [FEN: " << fen << "]\n";
+                assert (false);
+            }
+        }
+    }
+}
+
+void assertMakeUnmakeTree(const char* fen, int depth) {
+    UciPosition uciPosition;
+    std::istringstream is{fen};
+    uciPosition.readFen(is);
+
+    UnmakePosition pos{uciPosition};
+    long nodes = 0;
+    assertMakeUnmake(pos, depth, fen, nodes);
+    assert (nodes > 0);
+}
+
+void test_make_unmake_perft() {
+    assertMakeUnmakeTree("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 3);
+    assertMakeUnmakeTree("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 2); // castlings
+    assertMakeUnmakeTree("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 4); // en passant and pins
+    assertMakeUnmakeTree("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 2); // promotions
+    assertMakeUnmakeTree("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 2);
+}
+
+namespace TestMakeUnmake {
+    void test() {
+        test_make_unmake_perft();
+    }
+}
@@ -0,0 +1,59 @@
+#include "Hyperbola.hpp"
+#include "Pext.hpp"
+
+#if CPU_X86
+
+// all subsets of the given line occupancy, with random noise outside the line (carry-rippler enumeration)
+void assertPextLine(SliderType ty, Square from, Bb line, u64_t& seed) {
+    u64_t subset = 0;
+    do {
+        // xorshift pseudo random occupancy outside of the line must not change attacks
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        Bb occupied = Bb{subset} | (Bb{seed} % line);
+
+        Bb expected = Hyperbola{occupied}.attack(ty, from);
+        Bb attack = ::pextAttacks.attack(ty, from, occupied);
+        if (attack != expected) {
+            std::cerr << "FAIL: PEXT attack from " << from << "\n";
+            std::cerr << "Occupied:\n" << occupied << "\n";
+            std::cerr << "Attacks:\n" << attack << "\n";
+            std::cerr << "Expected:\n" << expected << "\n";
+            assert (false);
+        }
+
+        subset = (subset - line.v()) & line.v();
+    } while (subset != 0);
+}
+
+void test_pext_all_occupancies() {
+    if (Cpu::supported() < Isa{Avx2}) {
+        std::cerr << "PEXT tests skipped: no BMI2 instructions\n";
+        return;
+    }
+    assert (::pextAttacks.init());
+
+    u64_t seed = U64(0x9E37'79B9'7F4A'7C15);
+    for (auto sq : range<Square>()) {
+        Bb rookLine = sq.bbFile() | sq.bbRank();
+        Bb bishopLine = sq.bbDiagonal() | sq.bbAntidiag();
+
+        assertPextLine(SliderType{Rook}, sq, rookLine, seed);
+        assertPextLine(SliderType{Bishop}, sq, bishopLine, seed);
+        assertPextLine(SliderType{Queen}, sq, rookLine, seed);
+        assertPextLine(SliderType{Queen}, sq, bishopLine, seed);
+    }
+}
+
+namespace TestPext {
+    void test() {
+        test_pext_all_occupancies();
+    }
+}
+
+#else
+
+namespace TestPext {
+    void test() {}
+}
+
+#endif
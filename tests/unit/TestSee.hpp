@@ -0,0 +1,54 @@
+#include "PositionMoves.hpp"
+#include "Uci.hpp"
+
+// squares are from the side to move point of view, expected value is exact: see >= expected && !(see >= expected+1)
+void assertSee(const char* fen, Square::_t from, Square::_t to, int expected, const char* msg) {
+    UciPosition uciPosition;
+    std::istringstream is{fen};
+    uciPosition.readFen(is);
+    const PositionMoves& pos = uciPosition;
+
+    bool isAtLeast = pos.seeGe(Square{from}, Square{to}, expected);
+    bool isMore = pos.seeGe(Square{from}, Square{to}, expected + 1);
+    if (!isAtLeast || isMore) {
+        std::cerr << "FAIL: " << msg << " -> expected SEE " << expected
+                  << (isAtLeast ? " but greater" : " but less")
+                  << " [FEN: " << fen << "]\n";
+        assert (false);
+    }
+}
+
+void test_see_basic() {
+    assertSee("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", E1, E5, 80, "undefended pawn");
+    assertSee("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", D3, E5, 80 - 320, "knight for pawn");
+    assertSee("4k3/8/8/3p4/4P3/8/8/4K3 b - - 0 1", D4, E5, 80, "black side squares are flipped");
+    assertSee("4k3/8/8/8/8/8/8/R3K3 w - - 0 1", A1, A8, 0, "quiet move to safe square");
+    assertSee("4k3/8/8/8/8/8/8/2Kr4 w - - 0 1", C1, D1, 480, "king captures undefended rook");
+}
+
+void test_see_xray() {
+    assertSee("6k1/8/1n6/3p4/8/8/3R4/3R2K1 w - - 0 1", D2, D5, 80 - 480 + 320, "rook battery recaptures");
+    assertSee("8/8/8/3pk3/8/8/3R4/3R2K1 w - - 0 1", D2, D5, 80, "king cannot recapture defended square");
+    assertSee("3r2k1/8/1n6/3p4/8/8/3R4/3R2K1 w - - 0 1", D2, D5, 80 - 480, "stop exchange before losing more");
+}
+
+void test_see_pins() {
+    assertSee("4k3/8/4b3/3p4/8/8/8/3RR1K1 w - - 0 1", D1, D5, 80, "pinned defender");
+    assertSee("k4r2/8/2n5/8/3p4/1N3N2/8/5K2 w - - 0 1", B3, D4, 80 - 320, "pinned recapturer");
+}
+
+void test_see_special() {
+    assertSee("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", E5, D5, 80, "en passant");
+    assertSee("4k3/2p5/8/3pP3/8/8/8/4K3 w - d6 0 1", E5, D5, 0, "en passant recaptured on the destination square");
+    assertSee("3r3k/2P5/8/8/8/8/8/K7 w - - 0 1", C7, C8, 960 - 80 - 960, "queen promotion recaptured");
+    assertSee("3r3k/2P5/8/8/8/8/8/K7 w - - 0 1", C7, D8, 480 + 960 - 80, "queen promotion with capture");
+}
+
+namespace TestSee {
+    void test() {
+        test_see_basic();
+        test_see_xray();
+        test_see_pins();
+        test_see_special();
+    }
+}
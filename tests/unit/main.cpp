@@ -3,6 +3,12 @@
 #include "TestHyperbola.hpp"
 #include "TestHistoryMoves.hpp"
 #include "TestRepetitions.hpp"
+#include "TestCaptures.hpp"
+#include "TestPext.hpp"
+#include "TestSee.hpp"
+#include "TestMakeUnmake.hpp"
+#include "TestKeyAfter.hpp"
+#include "TestCountMoves.hpp"
 #include "Uci.hpp"
 
 /* mocks */
@@ -24,6 +30,12 @@ int main() {
         TestHyperbola::test();
         TestHistoryMoves::test();
         TestRepetitions::test();
+        TestCaptures::test();
+        TestPext::test();
+        TestSee::test();
+        TestMakeUnmake::test();
+        TestKeyAfter::test();
+        TestCountMoves::test();
 
         std::cerr << "✅ All tests passed!\n";
         return 0;